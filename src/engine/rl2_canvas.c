@@ -1,30 +1,52 @@
 #include "rl2_canvas.h"
 #include "rl2_heap.h"
 #include "rl2_log.h"
+#include "rl2_span.h"
 
 #include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
 
 #define TAG "CNV "
 
-// Image blit is coded for 16 bpp, make sure the build fails if hh2_RGB565 does not have 16 bits
-typedef char rl2_staticAssertColorMustHave16Bits[sizeof(rl2_RGB565) == 2 ? 1 : -1];
+// Image blit is coded for 16 and 32 bpp, make sure the build fails if rl2_Pixel has any other size
+typedef char rl2_staticAssertColorMustHave16Or32Bits[sizeof(rl2_Pixel) == 2 || sizeof(rl2_Pixel) == 4 ? 1 : -1];
+
+typedef struct {
+    unsigned x0;
+    unsigned x1; // clean rows have x0 >= x1
+}
+rl2_RowDamage;
 
 struct rl2_Canvas {
     unsigned width;
     unsigned height;
     size_t pitch; // in bytes
 
-    rl2_RGB565 pixels[1];
+    // NULL when damage isn't tracked, otherwise height extents with damaged rows in [damage_y0, damage_y1)
+    rl2_RowDamage* damage;
+    unsigned damage_y0;
+    unsigned damage_y1;
+
+    // Pixels are right after the canvas when it's created by rl2_createCanvas, otherwise they belong to someone else
+    // along with the padding at the end of the rows
+    rl2_Pixel* pixels;
+    bool owned;
+
+    // With ring rows, row y is stored at physical row (origin + y) % height so that scrolling vertically doesn't move
+    // any pixels; otherwise origin is always 0
+    bool ring;
+    unsigned origin;
 };
 
 rl2_Canvas rl2_createCanvas(unsigned const width, unsigned const height) {
-    size_t const pitch = ((width + 3) & ~3) * sizeof(rl2_RGB565);
+    size_t const pitch = ((width + 3) & ~3) * sizeof(rl2_Pixel);
     size_t const size = pitch * height;
 
     RL2_DEBUG(TAG "canvas pitch is %zu", pitch);
     RL2_DEBUG(TAG "allocating %zu bytes for the canvas", size);
 
-    rl2_Canvas const canvas = (rl2_Canvas)rl2_alloc(sizeof(*canvas) + size - sizeof(canvas->pixels[0]));
+    rl2_Canvas const canvas = (rl2_Canvas)rl2_alloc(sizeof(*canvas) + size);
 
     if (canvas == NULL) {
         RL2_ERROR(TAG "out of memory creating canvas");
@@ -34,13 +56,68 @@ rl2_Canvas rl2_createCanvas(unsigned const width, unsigned const height) {
     canvas->width = width;
     canvas->height = height;
     canvas->pitch = pitch;
+    canvas->damage = NULL;
+    canvas->pixels = (rl2_Pixel*)(canvas + 1);
+    canvas->owned = true;
+    canvas->ring = false;
+    canvas->origin = 0;
 
     RL2_INFO(TAG "canvas created @%p, width=%u, height=%u, pitch=%zu", canvas, width, height, pitch);
     return canvas;
 }
 
+static bool rl2_validPitch(unsigned const width, size_t const pitch) {
+    if (pitch < width * sizeof(rl2_Pixel) || (pitch % sizeof(rl2_Pixel)) != 0) {
+        RL2_ERROR(TAG "invalid pitch %zu for a canvas with width %u", pitch, width);
+        return false;
+    }
+
+    return true;
+}
+
+rl2_Canvas rl2_wrapCanvas(void* const pixels, unsigned const width, unsigned const height, size_t const pitch) {
+    if (!rl2_validPitch(width, pitch)) {
+        return NULL;
+    }
+
+    rl2_Canvas const canvas = (rl2_Canvas)rl2_alloc(sizeof(*canvas));
+
+    if (canvas == NULL) {
+        RL2_ERROR(TAG "out of memory creating canvas");
+        return NULL;
+    }
+
+    canvas->width = width;
+    canvas->height = height;
+    canvas->pitch = pitch;
+    canvas->damage = NULL;
+    canvas->pixels = (rl2_Pixel*)pixels;
+    canvas->owned = false;
+    canvas->ring = false;
+    canvas->origin = 0;
+
+    RL2_INFO(TAG "canvas wrapped @%p around %p, width=%u, height=%u, pitch=%zu", canvas, pixels, width, height, pitch);
+    return canvas;
+}
+
+bool rl2_retargetCanvas(rl2_Canvas const canvas, void* const pixels, size_t const pitch) {
+    if (canvas->owned) {
+        RL2_ERROR(TAG "canvas @%p wasn't created with rl2_wrapCanvas and can't be retargeted", canvas);
+        return false;
+    }
+
+    if (!rl2_validPitch(canvas->width, pitch)) {
+        return false;
+    }
+
+    canvas->pixels = (rl2_Pixel*)pixels;
+    canvas->pitch = pitch;
+    return true;
+}
+
 void rl2_destroyCanvas(rl2_Canvas const canvas) {
     RL2_INFO(TAG "freeing canvas @%p", canvas);
+    rl2_free(canvas->damage);
     rl2_free(canvas);
 }
 
@@ -56,21 +133,419 @@ size_t rl2_canvasPitch(rl2_Canvas const canvas) {
     return canvas->pitch;
 }
 
-void rl2_clearCanvas(rl2_Canvas const canvas, rl2_RGB565 const color) {
-    unsigned const width = canvas->width;
-    unsigned const height = canvas->height;
-    size_t const pitch = canvas->pitch;
-    rl2_RGB565* pixel = canvas->pixels;
+// True when the canvas can be written from the first to the last row in one go, padding included
+static bool rl2_contiguous(rl2_Canvas const canvas) {
+    return canvas->owned || canvas->pitch == canvas->width * sizeof(rl2_Pixel);
+}
+
+void rl2_clearCanvas(rl2_Canvas const canvas, rl2_Pixel const color) {
+    if (rl2_contiguous(canvas)) {
+        rl2_fillSpan(canvas->pixels, canvas->pitch / sizeof(rl2_Pixel) * canvas->height, color);
+    }
+    else {
+        rl2_fillRect(canvas, 0, 0, canvas->width, canvas->height, color);
+    }
+
+    rl2_damageCanvas(canvas, 0, 0, canvas->width, canvas->height);
+}
+
+static bool rl2_clipRect(
+    rl2_Canvas const canvas, int* const x0, int* const y0, unsigned* const width, unsigned* const height) {
+
+    int64_t left = *x0, top = *y0;
+    int64_t right = left + *width, bottom = top + *height;
+
+    left = left < 0 ? 0 : left;
+    top = top < 0 ? 0 : top;
+    right = right > canvas->width ? canvas->width : right;
+    bottom = bottom > canvas->height ? canvas->height : bottom;
+
+    if (left >= right || top >= bottom) {
+        return false;
+    }
+
+    *x0 = (int)left;
+    *y0 = (int)top;
+    *width = (unsigned)(right - left);
+    *height = (unsigned)(bottom - top);
+    return true;
+}
+
+void rl2_fillRect(
+    rl2_Canvas const canvas, int x0, int y0, unsigned width, unsigned height, rl2_Pixel const color) {
+
+    if (!rl2_clipRect(canvas, &x0, &y0, &width, &height)) {
+        return;
+    }
+
+    rl2_Pixel* pixel = rl2_canvasPixel(canvas, x0, y0);
+
+    for (unsigned y = 0; y < height; y++) {
+        rl2_fillSpan(pixel, width, color);
+        pixel = rl2_canvasNextRow(canvas, pixel);
+    }
+
+    rl2_damageCanvas(canvas, x0, y0, width, height);
+}
+
+static rl2_Pixel rl2_premultiplyColor(rl2_Pixel const color, uint8_t const alpha) {
+#ifdef RL2_PIXEL_XRGB8888
+    uint32_t const r = ((color >> 16) & 255) * alpha / 255;
+    uint32_t const g = ((color >> 8) & 255) * alpha / 255;
+    uint32_t const b = (color & 255) * alpha / 255;
+    return RL2_COLOR(r, g, b);
+#else
+    rl2_Pixel const r = (color >> 11) * alpha / 255;
+    rl2_Pixel const g = ((color >> 5) & 0x3fU) * alpha / 255;
+    rl2_Pixel const b = (color & 0x1fU) * alpha / 255;
+    return r << 11 | g << 5 | b;
+#endif
+}
+
+void rl2_fillRectBlend(
+    rl2_Canvas const canvas, int x0, int y0, unsigned width, unsigned height, rl2_Pixel const color, uint8_t const alpha) {
+
+    // Same alpha quantization used for RL2_RLE_COMPOSE runs in rl2_createImage
+    uint8_t const real_alpha = ((uint16_t)alpha + 4) / 8;
+
+    if (real_alpha == 0) {
+        return;
+    }
+    else if (real_alpha == 32) {
+        rl2_fillRect(canvas, x0, y0, width, height, color);
+        return;
+    }
+
+    if (!rl2_clipRect(canvas, &x0, &y0, &width, &height)) {
+        return;
+    }
+
+    rl2_Pixel const premultiplied = rl2_premultiplyColor(color, alpha);
+    uint8_t const inv_alpha = 32 - real_alpha;
+
+    rl2_Pixel* pixel = rl2_canvasPixel(canvas, x0, y0);
+
+    for (unsigned y = 0; y < height; y++) {
+        rl2_blendSpan(pixel, width, premultiplied, inv_alpha);
+        pixel = rl2_canvasNextRow(canvas, pixel);
+    }
+
+    rl2_damageCanvas(canvas, x0, y0, width, height);
+}
+
+void rl2_copyRect(
+    rl2_Canvas const canvas, rl2_Canvas const source, int x0, int y0, unsigned width, unsigned height) {
+
+    if (!rl2_clipRect(canvas, &x0, &y0, &width, &height) || !rl2_clipRect(source, &x0, &y0, &width, &height)) {
+        return;
+    }
+
+    rl2_damageCanvas(canvas, x0, y0, width, height);
+
+    if (x0 == 0 && width == canvas->width && canvas->pitch == source->pitch && rl2_contiguous(canvas) &&
+        rl2_contiguous(source) && canvas->origin == 0 && source->origin == 0) {
+        // Full rows with the same layout, copy them in one go
+        memcpy(rl2_canvasPixel(canvas, 0, y0), rl2_canvasPixel(source, 0, y0), canvas->pitch * height);
+        return;
+    }
+
+    rl2_Pixel* pixel = rl2_canvasPixel(canvas, x0, y0);
+    rl2_Pixel const* src = rl2_canvasPixel(source, x0, y0);
 
     for (unsigned y = 0; y < height; y++) {
-        for (unsigned x = 0; x < width; x++) {
-            pixel[x] = color;
+        memcpy(pixel, src, width * sizeof(*pixel));
+
+        pixel = rl2_canvasNextRow(canvas, pixel);
+        src = rl2_canvasNextRow(source, src);
+    }
+}
+
+bool rl2_trackCanvasDamage(rl2_Canvas const canvas, bool const enable) {
+    if (!enable) {
+        rl2_free(canvas->damage);
+        canvas->damage = NULL;
+        return true;
+    }
+
+    if (canvas->damage == NULL) {
+        canvas->damage = (rl2_RowDamage*)rl2_alloc(sizeof(*canvas->damage) * (canvas->height != 0 ? canvas->height : 1));
+
+        if (canvas->damage == NULL) {
+            RL2_ERROR(TAG "out of memory");
+            return false;
+        }
+
+        // Whatever is in the canvas now wasn't seen by anyone yet
+        for (unsigned y = 0; y < canvas->height; y++) {
+            canvas->damage[y].x0 = canvas->damage[y].x1 = 0;
+        }
+
+        canvas->damage_y0 = canvas->damage_y1 = 0;
+        rl2_damageCanvas(canvas, 0, 0, canvas->width, canvas->height);
+    }
+
+    return true;
+}
+
+void rl2_resetCanvasDamage(rl2_Canvas const canvas) {
+    rl2_RowDamage* const damage = canvas->damage;
+
+    if (damage == NULL) {
+        return;
+    }
+
+    for (unsigned y = canvas->damage_y0; y < canvas->damage_y1; y++) {
+        damage[y].x0 = damage[y].x1 = 0;
+    }
+
+    canvas->damage_y0 = canvas->damage_y1 = 0;
+}
+
+void rl2_damageCanvas(rl2_Canvas const canvas, int x0, int y0, unsigned width, unsigned height) {
+    rl2_RowDamage* const damage = canvas->damage;
+
+    if (damage == NULL || !rl2_clipRect(canvas, &x0, &y0, &width, &height)) {
+        return;
+    }
+
+    unsigned const x1 = x0 + width;
+    unsigned const y1 = y0 + height;
+
+    // Rows outside [damage_y0, damage_y1) are always clean
+    for (unsigned y = y0; y < y1; y++) {
+        rl2_RowDamage* const row = damage + y;
+
+        if (row->x0 >= row->x1) {
+            row->x0 = x0;
+            row->x1 = x1;
+        }
+        else {
+            row->x0 = row->x0 < (unsigned)x0 ? row->x0 : (unsigned)x0;
+            row->x1 = row->x1 > x1 ? row->x1 : x1;
         }
+    }
 
-        pixel = (rl2_RGB565*)((uint8_t*)pixel + pitch);
+    if (canvas->damage_y0 >= canvas->damage_y1) {
+        canvas->damage_y0 = y0;
+        canvas->damage_y1 = y1;
+    }
+    else {
+        canvas->damage_y0 = canvas->damage_y0 < (unsigned)y0 ? canvas->damage_y0 : (unsigned)y0;
+        canvas->damage_y1 = canvas->damage_y1 > y1 ? canvas->damage_y1 : y1;
     }
 }
 
-rl2_RGB565* rl2_canvasPixel(rl2_Canvas const canvas, unsigned const x, unsigned const y) {
-    return (rl2_RGB565*)((uint8_t*)canvas->pixels + y * canvas->pitch) + x;
+size_t rl2_canvasDamage(rl2_Canvas const canvas, rl2_DamageRect* const rects, size_t const max_rects) {
+    if (max_rects == 0) {
+        return 0;
+    }
+
+    rl2_RowDamage const* const damage = canvas->damage;
+
+    if (damage == NULL) {
+        rects[0].x0 = rects[0].y0 = 0;
+        rects[0].width = canvas->width;
+        rects[0].height = canvas->height;
+        return 1;
+    }
+
+    size_t count = 0;
+    rl2_DamageRect* rect = NULL;
+
+    for (unsigned y = canvas->damage_y0; y < canvas->damage_y1; y++) {
+        rl2_RowDamage const* const row = damage + y;
+
+        if (row->x0 >= row->x1) {
+            rect = NULL;
+            continue;
+        }
+
+        if (rect != NULL && rect->x0 == row->x0 && rect->x0 + rect->width == row->x1) {
+            // Same extent as the row above
+            rect->height++;
+        }
+        else if (count < max_rects) {
+            rect = rects + count++;
+            rect->x0 = row->x0;
+            rect->y0 = y;
+            rect->width = row->x1 - row->x0;
+            rect->height = 1;
+        }
+        else {
+            // Out of rectangles, grow the last one to include this row
+            rect = rects + count - 1;
+
+            unsigned const x0 = rect->x0 < row->x0 ? rect->x0 : row->x0;
+            unsigned const x1 = rect->x0 + rect->width > row->x1 ? rect->x0 + rect->width : row->x1;
+
+            rect->x0 = x0;
+            rect->width = x1 - x0;
+            rect->height = y + 1 - rect->y0;
+        }
+    }
+
+    return count;
+}
+
+bool rl2_canvasRowDamage(rl2_Canvas const canvas, unsigned const y, unsigned* const x0, unsigned* const x1) {
+    rl2_RowDamage const* const damage = canvas->damage;
+
+    if (y >= canvas->height) {
+        return false;
+    }
+
+    if (damage == NULL) {
+        *x0 = 0;
+        *x1 = canvas->width;
+        return true;
+    }
+
+    if (damage[y].x0 >= damage[y].x1) {
+        return false;
+    }
+
+    *x0 = damage[y].x0;
+    *x1 = damage[y].x1;
+    return true;
+}
+
+rl2_Pixel* rl2_canvasPixel(rl2_Canvas const canvas, unsigned const x, unsigned const y) {
+    unsigned const row = y < canvas->height - canvas->origin ? y + canvas->origin : y - (canvas->height - canvas->origin);
+    return (rl2_Pixel*)((uint8_t*)canvas->pixels + (size_t)row * canvas->pitch) + x;
+}
+
+rl2_Pixel* rl2_canvasNextRow(rl2_Canvas const canvas, rl2_Pixel const* const pixel) {
+    uint8_t* const next = (uint8_t*)pixel + canvas->pitch;
+    size_t const size = canvas->pitch * canvas->height;
+
+    // Only scrolled canvases wrap around, and only when pixel is in the last physical row
+    return (rl2_Pixel*)(next < (uint8_t*)canvas->pixels + size ? next : next - size);
+}
+
+// Swaps the pixels of two physical rows
+static void rl2_swapRows(rl2_Canvas const canvas, unsigned const row0, unsigned const row1) {
+    rl2_Pixel* const pixels0 = (rl2_Pixel*)((uint8_t*)canvas->pixels + (size_t)row0 * canvas->pitch);
+    rl2_Pixel* const pixels1 = (rl2_Pixel*)((uint8_t*)canvas->pixels + (size_t)row1 * canvas->pitch);
+    rl2_Pixel buffer[256];
+
+    for (unsigned x = 0; x < canvas->width; x += 256) {
+        size_t const size = (canvas->width - x < 256 ? canvas->width - x : 256) * sizeof(rl2_Pixel);
+
+        memcpy(buffer, pixels0 + x, size);
+        memcpy(pixels0 + x, pixels1 + x, size);
+        memcpy(pixels1 + x, buffer, size);
+    }
+}
+
+// Reverses the order of the physical rows in [row0, row1)
+static void rl2_reverseRows(rl2_Canvas const canvas, unsigned row0, unsigned row1) {
+    while (row0 + 1 < row1) {
+        rl2_swapRows(canvas, row0++, --row1);
+    }
+}
+
+bool rl2_ringCanvasRows(rl2_Canvas const canvas, bool const enable) {
+    if (enable && !canvas->owned) {
+        RL2_ERROR(TAG "canvas @%p wasn't created with rl2_createCanvas and can't have ring rows", canvas);
+        return false;
+    }
+
+    if (!enable && canvas->origin != 0) {
+        // Put the rows back in order by rotating them up by origin
+        rl2_reverseRows(canvas, 0, canvas->origin);
+        rl2_reverseRows(canvas, canvas->origin, canvas->height);
+        rl2_reverseRows(canvas, 0, canvas->height);
+        canvas->origin = 0;
+    }
+
+    canvas->ring = enable;
+    return true;
+}
+
+// Moves the pixels of rows [y0, y0 + height) dx pixels to the right, or to the left when dx is negative
+static void rl2_shiftRows(rl2_Canvas const canvas, int const dx, unsigned const y0, unsigned const height) {
+    unsigned const distance = dx < 0 ? -dx : dx;
+    size_t const size = (canvas->width - distance) * sizeof(rl2_Pixel);
+
+    for (unsigned y = y0; y < y0 + height; y++) {
+        rl2_Pixel* const row = rl2_canvasPixel(canvas, 0, y);
+
+        if (dx > 0) {
+            memmove(row + distance, row, size);
+        }
+        else {
+            memmove(row, row + distance, size);
+        }
+    }
+}
+
+size_t rl2_scrollCanvas(rl2_Canvas const canvas, int const dx, int const dy, rl2_DamageRect* const exposed) {
+    unsigned const width = canvas->width;
+    unsigned const height = canvas->height;
+    unsigned const distance_x = dx < 0 ? -(unsigned)dx : (unsigned)dx;
+    unsigned const distance_y = dy < 0 ? -(unsigned)dy : (unsigned)dy;
+    rl2_DamageRect rects[2];
+    size_t count = 0;
+
+    if (dx == 0 && dy == 0) {
+        // Nothing moves, nothing is damaged
+        return 0;
+    }
+
+    rl2_damageCanvas(canvas, 0, 0, width, height);
+
+    if (distance_x >= width || distance_y >= height) {
+        // Nothing stays on the canvas
+        rects[count].x0 = rects[count].y0 = 0;
+        rects[count].width = width;
+        rects[count].height = height;
+        count++;
+    }
+    else {
+        if (dy != 0) {
+            if (canvas->ring) {
+                // Row y now shows what was at row y - dy
+                canvas->origin = (canvas->origin + height - (dy > 0 ? distance_y : height - distance_y)) % height;
+            }
+            else {
+                size_t const size = width * sizeof(rl2_Pixel);
+
+                if (dy > 0) {
+                    for (unsigned y = height - 1; y >= distance_y; y--) {
+                        memcpy(rl2_canvasPixel(canvas, 0, y), rl2_canvasPixel(canvas, 0, y - distance_y), size);
+                    }
+                }
+                else {
+                    for (unsigned y = 0; y < height - distance_y; y++) {
+                        memcpy(rl2_canvasPixel(canvas, 0, y), rl2_canvasPixel(canvas, 0, y + distance_y), size);
+                    }
+                }
+            }
+
+            rects[count].x0 = 0;
+            rects[count].y0 = dy > 0 ? 0 : height - distance_y;
+            rects[count].width = width;
+            rects[count].height = distance_y;
+            count++;
+        }
+
+        if (dx != 0) {
+            // Rows exposed by the vertical scroll will be drawn anyway, only shift the others
+            unsigned const y0 = dy > 0 ? distance_y : 0;
+            unsigned const rows = height - distance_y;
+            rl2_shiftRows(canvas, dx, y0, rows);
+
+            rects[count].x0 = dx > 0 ? 0 : width - distance_x;
+            rects[count].y0 = y0;
+            rects[count].width = distance_x;
+            rects[count].height = rows;
+            count++;
+        }
+    }
+
+    if (exposed != NULL) {
+        memcpy(exposed, rects, count * sizeof(*rects));
+    }
+
+    return count;
 }
@@ -3,21 +3,99 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
 
 #define RL2_COLOR_RGB565(r, g, b) ((((rl2_RGB565)(r) << 8 | (rl2_RGB565)(b) >> 3) & 0xf81fU) | (((rl2_RGB565)(g) << 3) & 0x07e0U))
 
 typedef uint16_t rl2_RGB565;
+
+// Canvas pixels are RGB565 unless the engine is built with RL2_PIXEL_XRGB8888, which lets 32-bit displays take the
+// canvas as is; rl2_Image pixels and the RLE words holding them follow the canvas format
+#ifdef RL2_PIXEL_XRGB8888
+#define RL2_COLOR(r, g, b) \
+    (UINT32_C(0xff000000) | ((uint32_t)(r) & 255) << 16 | ((uint32_t)(g) & 255) << 8 | ((uint32_t)(b) & 255))
+
+typedef uint32_t rl2_Pixel;
+#else
+#define RL2_COLOR(r, g, b) RL2_COLOR_RGB565(r, g, b)
+
+typedef rl2_RGB565 rl2_Pixel;
+#endif
+
 typedef struct rl2_Canvas* rl2_Canvas;
 
+typedef struct {
+    unsigned x0;
+    unsigned y0;
+    unsigned width;
+    unsigned height;
+}
+rl2_DamageRect;
+
 rl2_Canvas rl2_createCanvas(unsigned const width, unsigned const height);
+
+// Draws straight into pixels, which must have height rows of pitch bytes and outlive the canvas; only the width
+// pixels of each row are ever touched
+rl2_Canvas rl2_wrapCanvas(void* const pixels, unsigned const width, unsigned const height, size_t const pitch);
+
+// Points a canvas created by rl2_wrapCanvas to other pixels with the same width and height, i.e. the next back buffer
+bool rl2_retargetCanvas(rl2_Canvas const canvas, void* const pixels, size_t const pitch);
+
 void rl2_destroyCanvas(rl2_Canvas const canvas);
 
 unsigned rl2_canvasWidth(rl2_Canvas const canvas);
 unsigned rl2_canvasHeight(rl2_Canvas const canvas);
+// Bytes from one row to the next in memory; once a canvas with ring rows is scrolled vertically, rl2_canvasPixel(canvas,
+// 0, 0) is no longer the first row in memory and adding the pitch doesn't always get to the next row, see
+// rl2_ringCanvasRows
 size_t rl2_canvasPitch(rl2_Canvas const canvas);
 
-void rl2_clearCanvas(rl2_Canvas const canvas, rl2_RGB565 const color);
+void rl2_clearCanvas(rl2_Canvas const canvas, rl2_Pixel const color);
+
+void rl2_fillRect(
+    rl2_Canvas const canvas, int const x0, int const y0, unsigned const width, unsigned const height, rl2_Pixel const color);
+
+// alpha goes from 0 (transparent) to 255 (opaque), and is quantized to 32 levels like image pixels
+void rl2_fillRectBlend(
+    rl2_Canvas const canvas, int const x0, int const y0, unsigned const width, unsigned const height,
+    rl2_Pixel const color, uint8_t const alpha);
+
+// Copies the rectangle from source to the same place in canvas
+void rl2_copyRect(
+    rl2_Canvas const canvas, rl2_Canvas const source, int const x0, int const y0, unsigned const width,
+    unsigned const height);
+
+// Damage tracking records the extent of the pixels changed in each row since the last rl2_resetCanvasDamage; it's
+// off by default
+bool rl2_trackCanvasDamage(rl2_Canvas const canvas, bool const enable);
+void rl2_resetCanvasDamage(rl2_Canvas const canvas);
+
+// For code that writes to the canvas pixels directly
+void rl2_damageCanvas(rl2_Canvas const canvas, int const x0, int const y0, unsigned const width, unsigned const height);
+
+// Returns the changed pixels as rows with the same extent merged into rectangles, writing at most max_rects to rects;
+// when there are more, the last one is the bounding box of all the rest. All of the canvas is damaged when tracking
+// is off
+size_t rl2_canvasDamage(rl2_Canvas const canvas, rl2_DamageRect* const rects, size_t const max_rects);
+
+// Returns false if nothing changed in the row, otherwise the changed pixels are somewhere in [*x0, *x1)
+bool rl2_canvasRowDamage(rl2_Canvas const canvas, unsigned const y, unsigned* const x0, unsigned* const x1);
+
+rl2_Pixel* rl2_canvasPixel(rl2_Canvas const canvas, unsigned const x, unsigned const y);
+
+// Returns the pixel below the given one, wrapping around the ring rows; code that walks down canvases that may have
+// ring rows must use this instead of adding the pitch
+rl2_Pixel* rl2_canvasNextRow(rl2_Canvas const canvas, rl2_Pixel const* const pixel);
+
+// Ring rows make vertical scrolling only change the row where the canvas starts instead of moving the pixels, at the
+// cost of rows no longer being in order in memory. They're off by default and only available for canvases created by
+// rl2_createCanvas; turning them off puts the rows back in order
+bool rl2_ringCanvasRows(rl2_Canvas const canvas, bool const enable);
 
-rl2_RGB565* rl2_canvasPixel(rl2_Canvas const canvas, unsigned const x, unsigned const y);
+// Moves the contents of the canvas dx pixels to the right and dy pixels down, negative values go left and up, and
+// writes the parts that must be redrawn to exposed, which must have room for two rectangles; returns how many there
+// are. Vertical scrolling copies the rows that stay unless the canvas has ring rows, horizontal scrolling always moves
+// the pixels of those rows. A scroll by (0, 0) does nothing and returns 0, any other one damages the whole canvas
+size_t rl2_scrollCanvas(rl2_Canvas const canvas, int const dx, int const dy, rl2_DamageRect* const exposed);
 
 #endif // RL2_CANVAS_H__
@@ -0,0 +1,158 @@
+#include "rl2_convert.h"
+#include "rl2_jobs.h"
+#include "rl2_log.h"
+#include "rl2_span.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#define TAG "CVT "
+
+// Rows converted by each job, enough to amortize the job overhead
+#define RL2_CONVERT_BATCH 16
+
+// Pixels converted at a time into the local buffer before being scaled
+#define RL2_CONVERT_CHUNK 256
+
+typedef struct {
+    rl2_Canvas canvas;
+    uint8_t* output;
+    size_t pitch;
+    rl2_OutputFormat format;
+    unsigned scale;
+    bool damaged_only;
+}
+rl2_Conversion;
+
+static size_t rl2_outputPixelSize(rl2_OutputFormat const format) {
+    return format == RL2_OUTPUT_RGB555 ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+static void rl2_convertPixels(
+    void* const dst, rl2_Pixel const* const src, size_t const count, rl2_OutputFormat const format) {
+
+    switch (format) {
+        case RL2_OUTPUT_XRGB8888: rl2_xrgb8888Span((uint32_t*)dst, src, count); break;
+        case RL2_OUTPUT_ABGR8888: rl2_abgr8888Span((uint32_t*)dst, src, count); break;
+        case RL2_OUTPUT_RGB555: rl2_rgb555Span((uint16_t*)dst, src, count); break;
+    }
+}
+
+static void rl2_scale32(uint32_t* const dst, uint32_t const* const src, size_t const count, unsigned const scale) {
+    uint32_t* out = dst;
+
+    if (scale == 2) {
+        for (size_t i = 0; i < count; i++, out += 2) {
+            out[0] = out[1] = src[i];
+        }
+
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        for (unsigned j = 0; j < scale; j++) {
+            *out++ = src[i];
+        }
+    }
+}
+
+static void rl2_scale16(uint16_t* const dst, uint16_t const* const src, size_t const count, unsigned const scale) {
+    uint16_t* out = dst;
+
+    if (scale == 2) {
+        for (size_t i = 0; i < count; i++, out += 2) {
+            out[0] = out[1] = src[i];
+        }
+
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        for (unsigned j = 0; j < scale; j++) {
+            *out++ = src[i];
+        }
+    }
+}
+
+static void rl2_convertRow(
+    rl2_Conversion const* const conv, unsigned const y, unsigned const x0, unsigned const x1) {
+
+    unsigned const scale = conv->scale;
+    size_t const pixel_size = rl2_outputPixelSize(conv->format);
+    rl2_Pixel const* const src = rl2_canvasPixel(conv->canvas, x0, y);
+    uint8_t* const dst = conv->output + (size_t)y * scale * conv->pitch + (size_t)x0 * scale * pixel_size;
+
+    if (scale == 1) {
+        rl2_convertPixels(dst, src, x1 - x0, conv->format);
+        return;
+    }
+
+    // Convert to the local buffer while it's in the cache and widen from there
+    uint32_t buffer[RL2_CONVERT_CHUNK];
+
+    for (unsigned x = 0; x < x1 - x0; x += RL2_CONVERT_CHUNK) {
+        size_t const count = x1 - x0 - x < RL2_CONVERT_CHUNK ? x1 - x0 - x : RL2_CONVERT_CHUNK;
+        rl2_convertPixels(buffer, src + x, count, conv->format);
+
+        if (pixel_size == sizeof(uint32_t)) {
+            rl2_scale32((uint32_t*)dst + (size_t)x * scale, buffer, count, scale);
+        }
+        else {
+            rl2_scale16((uint16_t*)dst + (size_t)x * scale, (uint16_t const*)buffer, count, scale);
+        }
+    }
+
+    // The other rows are copies of the first one
+    size_t const size = (size_t)(x1 - x0) * scale * pixel_size;
+
+    for (unsigned i = 1; i < scale; i++) {
+        memcpy(dst + i * conv->pitch, dst, size);
+    }
+}
+
+static void rl2_convertJob(void* const userdata, size_t const batch) {
+    rl2_Conversion const* const conv = (rl2_Conversion const*)userdata;
+    unsigned const width = rl2_canvasWidth(conv->canvas);
+    unsigned const height = rl2_canvasHeight(conv->canvas);
+    unsigned const y0 = batch * RL2_CONVERT_BATCH;
+    unsigned const y1 = height - y0 < RL2_CONVERT_BATCH ? height : y0 + RL2_CONVERT_BATCH;
+
+    for (unsigned y = y0; y < y1; y++) {
+        unsigned x0 = 0, x1 = width;
+
+        if (conv->damaged_only && !rl2_canvasRowDamage(conv->canvas, y, &x0, &x1)) {
+            continue;
+        }
+
+        rl2_convertRow(conv, y, x0, x1);
+    }
+}
+
+bool rl2_convertCanvas(
+    rl2_Canvas const canvas, void* const output, size_t const pitch, rl2_OutputFormat const format,
+    unsigned const scale, bool const damaged_only) {
+
+    if (format != RL2_OUTPUT_XRGB8888 && format != RL2_OUTPUT_ABGR8888 && format != RL2_OUTPUT_RGB555) {
+        RL2_ERROR(TAG "invalid output format %d", (int)format);
+        return false;
+    }
+
+    size_t const pixel_size = rl2_outputPixelSize(format);
+    unsigned const width = rl2_canvasWidth(canvas);
+
+    if (scale == 0 || pitch < (size_t)width * scale * pixel_size || pitch % pixel_size != 0) {
+        RL2_ERROR(TAG "invalid scale %u or pitch %zu for a canvas with width %u", scale, pitch, width);
+        return false;
+    }
+
+    rl2_Conversion conv;
+    conv.canvas = canvas;
+    conv.output = (uint8_t*)output;
+    conv.pitch = pitch;
+    conv.format = format;
+    conv.scale = scale;
+    conv.damaged_only = damaged_only;
+
+    rl2_parallelFor(rl2_convertJob, &conv, (rl2_canvasHeight(canvas) + RL2_CONVERT_BATCH - 1) / RL2_CONVERT_BATCH);
+    return true;
+}
@@ -0,0 +1,23 @@
+#ifndef RL2_CONVERT_H__
+#define RL2_CONVERT_H__
+
+#include "rl2_canvas.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef enum {
+    RL2_OUTPUT_XRGB8888, // uint32_t 0xffRRGGBB
+    RL2_OUTPUT_ABGR8888, // uint32_t 0xffBBGGRR
+    RL2_OUTPUT_RGB555    // uint16_t 0RRRRRGGGGGBBBBB
+}
+rl2_OutputFormat;
+
+// Converts the canvas to width * scale by height * scale pixels in output, which must be aligned to the pixel size
+// and have rows of pitch bytes, repeating every pixel scale times in both directions. With damaged_only, only the
+// pixels reported by rl2_canvasRowDamage are written. Rows are converted on the workers
+bool rl2_convertCanvas(
+    rl2_Canvas const canvas, void* const output, size_t const pitch, rl2_OutputFormat const format,
+    unsigned const scale, bool const damaged_only);
+
+#endif // RL2_CONVERT_H__
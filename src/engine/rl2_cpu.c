@@ -0,0 +1,68 @@
+#include "rl2_cpu.h"
+#include "rl2_log.h"
+
+#if defined(RL2_SIMD_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+#define TAG "CPU "
+
+static unsigned rl2_detectFeatures(void) {
+    unsigned features = 0;
+
+#if defined(RL2_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("sse2")) {
+        features |= RL2_CPU_SSE2;
+    }
+
+    if (__builtin_cpu_supports("avx2")) {
+        features |= RL2_CPU_AVX2;
+    }
+#elif defined(RL2_SIMD_X86) && defined(_MSC_VER)
+    int regs[4];
+    __cpuid(regs, 0);
+    int const max_leaf = regs[0];
+
+    __cpuid(regs, 1);
+
+    if ((regs[3] & (1 << 26)) != 0) {
+        features |= RL2_CPU_SSE2;
+    }
+
+    // AVX2 needs the OS to save the YMM registers, check OSXSAVE and XCR0 before leaf 7
+    if (max_leaf >= 7 && (regs[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6) {
+        __cpuidex(regs, 7, 0);
+
+        if ((regs[1] & (1 << 5)) != 0) {
+            features |= RL2_CPU_AVX2;
+        }
+    }
+#elif defined(RL2_SIMD_NEON)
+    // NEON is only enabled at compile time, when the target guarantees it
+    features |= RL2_CPU_NEON;
+#endif
+
+    return features;
+}
+
+unsigned rl2_cpuFeatures(void) {
+    static unsigned features = 0;
+    static int detected = 0;
+
+    if (!detected) {
+        features = rl2_detectFeatures();
+        detected = 1;
+
+        RL2_INFO(
+            TAG "cpu features:%s%s%s",
+            (features & RL2_CPU_SSE2) != 0 ? " sse2" : "",
+            (features & RL2_CPU_AVX2) != 0 ? " avx2" : "",
+            (features & RL2_CPU_NEON) != 0 ? " neon" : ""
+        );
+    }
+
+    return features;
+}
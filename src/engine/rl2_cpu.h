@@ -0,0 +1,32 @@
+#ifndef RL2_CPU_H__
+#define RL2_CPU_H__
+
+// Define RL2_NO_SIMD to build only the portable scalar kernels
+#ifndef RL2_NO_SIMD
+    #if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+        #define RL2_SIMD_X86
+    #elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(__aarch64__) || defined(_M_ARM64)
+        #define RL2_SIMD_NEON
+    #endif
+#endif
+
+#ifdef RL2_SIMD_X86
+    #if defined(__GNUC__) || defined(__clang__)
+        #define RL2_TARGET_SSE2 __attribute__((target("sse2")))
+        #define RL2_TARGET_AVX2 __attribute__((target("avx2")))
+    #else
+        #define RL2_TARGET_SSE2
+        #define RL2_TARGET_AVX2
+    #endif
+#endif
+
+typedef enum {
+    RL2_CPU_SSE2 = 1 << 0,
+    RL2_CPU_AVX2 = 1 << 1,
+    RL2_CPU_NEON = 1 << 2
+}
+rl2_CpuFeature;
+
+unsigned rl2_cpuFeatures(void);
+
+#endif // RL2_CPU_H__
@@ -1,7 +1,12 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L
+#endif
+
 #include "rl2_filesys.h"
 #include "rl2_log.h"
 #include "rl2_djb2.h"
 #include "rl2_heap.h"
+#include "rl2_thread.h"
 
 #include <inttypes.h>
 #include <stdio.h>
@@ -54,6 +59,10 @@ struct rl2_File {
 
 static rl2_Filesys* rl2_topFilesys = NULL;
 
+// Guards the file system stack so that files can be opened from the asset loaders while file systems are added;
+// open files only read their own entry and need no locking
+static rl2_Mutex rl2_filesysMutex = RL2_MUTEX_INIT;
+
 static int rl2_compareEntries(void const* const ptr1, void const* const ptr2) {
     rl2_Entry const* const entry1 = ptr1;
     rl2_Entry const* const entry2 = ptr2;
@@ -138,10 +147,6 @@ bool rl2_addFilesystem(void const* const buffer, size_t const size) {
     }
 
     filesys->num_entries = num_entries;
-    filesys->height = rl2_topFilesys == NULL ? 0 : rl2_topFilesys->height + 1;
-    filesys->previous = rl2_topFilesys;
-    rl2_topFilesys = filesys;
-
     num_entries = 0;
 
     for (rl2_TarEntryV7 const* entry = buffer; num_entries < filesys->num_entries; num_entries++) {
@@ -161,12 +166,23 @@ bool rl2_addFilesystem(void const* const buffer, size_t const size) {
     }
 
     qsort(filesys->entries, filesys->num_entries, sizeof(filesys->entries[0]), rl2_compareEntries);
+
+    // Only published when complete
+    rl2_lock(&rl2_filesysMutex);
+    filesys->height = rl2_topFilesys == NULL ? 0 : rl2_topFilesys->height + 1;
+    filesys->previous = rl2_topFilesys;
+    rl2_topFilesys = filesys;
+    rl2_unlock(&rl2_filesysMutex);
+
     RL2_DEBUG(TAG "created file system %p", filesys);
     return true;
 }
 
 void rl22_destroyFilesystem(void) {
+    rl2_lock(&rl2_filesysMutex);
     rl2_Filesys* filesys = rl2_topFilesys;
+    rl2_topFilesys = NULL;
+    rl2_unlock(&rl2_filesysMutex);
 
     while (filesys != NULL) {
         RL2_INFO(TAG "destroying file system %p", filesys);
@@ -174,18 +190,19 @@ void rl22_destroyFilesystem(void) {
         rl2_free(filesys);
         filesys = previous;
     }
-
-    rl2_topFilesys = NULL;
 }
 
 static rl2_Entry* rl2_fileFind(char const* const path, unsigned const max_height) {
+    rl2_Entry key;
+    key.tar_entry = (rl2_TarEntryV7*)path;
+    key.hash = rl2_djb2(path);
+
+    // File systems never change once pushed, only the top of the stack needs the lock
+    rl2_lock(&rl2_filesysMutex);
     rl2_Filesys* filesys = rl2_topFilesys;
+    rl2_unlock(&rl2_filesysMutex);
 
     while (filesys != NULL && filesys->height <= max_height) {
-        rl2_Entry key;
-        key.tar_entry = (rl2_TarEntryV7*)path;
-        key.hash = rl2_djb2(path);
-
         rl2_Entry* const found = bsearch(&key, filesys->entries, filesys->num_entries, sizeof(filesys->entries[0]), rl2_compareEntries);
 
         if (found != NULL) {
@@ -239,6 +256,17 @@ rl2_File rl2_openFile(char const* const path, unsigned const max_height) {
     return file;
 }
 
+void const* rl2_mapFile(char const* const path, unsigned const max_height, size_t* const size) {
+    rl2_Entry const* const found = rl2_fileFind(path, max_height);
+
+    if (found == NULL) {
+        return NULL;
+    }
+
+    *size = found->size;
+    return (uint8_t const*)found->tar_entry + 512;
+}
+
 int rl2_seek(rl2_File const file, long const offset, int const whence) {
     long const size = file->entry->size;
     long pos = 0;
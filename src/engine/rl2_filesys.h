@@ -10,12 +10,17 @@
 typedef struct rl2_File* rl2_File;
 
 // rl2_addFilesystem does **not** take ownership of buffer, keep it around until rl2_destroyFilesystem is called
+// Files can be opened and read from any thread, file systems can be added while other threads read files
 bool rl2_addFilesystem(void const* const buffer, size_t const size);
 void rl2_destroyFilesystem(void);
 
 bool rl2_fileExists(char const* const path, unsigned const max_height);
 long rl2_fileSize(char const* const path, unsigned const max_height);
 rl2_File rl2_openFile(char const* const path, unsigned const max_height);
+
+// Returns the contents of the file right where they are in the file system buffer, valid until rl2_destroyFilesystem
+void const* rl2_mapFile(char const* const path, unsigned const max_height, size_t* const size);
+
 int rl2_seek(rl2_File const file, long const offset, int const whence);
 long rl2_tell(rl2_File const file);
 size_t rl2_read(rl2_File const file, void* const buffer, size_t const size);
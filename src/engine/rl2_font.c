@@ -2,9 +2,23 @@
 #include "rl2_log.h"
 #include "rl2_heap.h"
 
-#define AL_BDF_CANVAS_TYPE rl2_PixelSource
+// Glyphs are drawn straight into the rows of the pixel source instead of through rl2_putPixel
+typedef struct {
+    rl2_ARGB8888* pixels;
+    size_t pitch;
+    unsigned width;
+    unsigned height;
+}
+rl2_BdfCanvas;
+
+#define AL_BDF_CANVAS_TYPE rl2_BdfCanvas const*
 #define AL_BDF_COLOR_TYPE rl2_ARGB8888
-#define AL_BDF_PUT_PIXEL(source, x, y, color) do { rl2_putPixel(source, x, y, color); } while (0)
+#define AL_BDF_PUT_PIXEL(canvas, x, y, color) \
+    do { \
+        if ((unsigned)(x) < (canvas)->width && (unsigned)(y) < (canvas)->height) { \
+            (canvas)->pixels[(y) * (canvas)->pitch + (x)] = (color); \
+        } \
+    } while (0)
 #define AL_BDF_MALLOC rl2_alloc
 #define AL_BDF_REALLOC rl2_realloc
 #define AL_BDF_FREE rl2_free
@@ -112,7 +126,13 @@ rl2_PixelSource rl2_renderText(
         return NULL;
     }
 
+    rl2_BdfCanvas canvas;
+    canvas.pixels = rl2_pixelSourceRow(source, 0);
+    canvas.pitch = rl2_pixelSourcePitch(source);
+    canvas.width = (unsigned)width;
+    canvas.height = (unsigned)height;
+
     rl2_fillPixelSource(source, bg_color);
-    al_bdf_render(&font->bdf, text, source, fg_color);
+    al_bdf_render(&font->bdf, text, &canvas, fg_color);
     return source;
 }
@@ -1,5 +1,10 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L
+#endif
+
 #include "rl2_heap.h"
 #include "rl2_log.h"
+#include "rl2_thread.h"
 
 #include <stdlib.h>
 
@@ -35,19 +40,34 @@ static void* rl2_libcAlloc(void* userdata, void* pointer, size_t size) {
 static rl2_Allocf rl2_heapAlloc = rl2_libcAlloc;
 static void* rl2_heapUserdata = NULL;
 
+// Serializes calls to custom allocators, that can't be assumed to be thread safe
+static rl2_Mutex rl2_heapMutex = RL2_MUTEX_INIT;
+
+static void* rl2_callAlloc(void* pointer, size_t size) {
+    if (rl2_heapAlloc == rl2_libcAlloc) {
+        // The C library allocator is already thread safe
+        return rl2_libcAlloc(NULL, pointer, size);
+    }
+
+    rl2_lock(&rl2_heapMutex);
+    void* const result = rl2_heapAlloc(rl2_heapUserdata, pointer, size);
+    rl2_unlock(&rl2_heapMutex);
+    return result;
+}
+
 void rl2_setAlloc(rl2_Allocf alloc, void* userdata) {
     rl2_heapAlloc = alloc;
     rl2_heapUserdata = userdata;
 }
 
 void* rl2_alloc(size_t size) {
-    return rl2_heapAlloc(rl2_heapUserdata, NULL, size);
+    return rl2_callAlloc(NULL, size);
 }
 
 void rl2_free(void* pointer) {
-    rl2_heapAlloc(rl2_heapUserdata, pointer, 0);
+    rl2_callAlloc(pointer, 0);
 }
 
 void* rl2_realloc(void* pointer, size_t size) {
-    return rl2_heapAlloc(rl2_heapUserdata, pointer, size);
+    return rl2_callAlloc(pointer, size);
 }
@@ -5,6 +5,7 @@
 
 typedef void* (*rl2_Allocf)(void* userdata, void* pointer, size_t size);
 
+// Must be called before any threads are started; calls to alloc are serialized so it doesn't have to be thread safe
 void rl2_setAlloc(rl2_Allocf alloc, void* userdata);
 
 void* rl2_alloc(size_t size);
@@ -1,16 +1,19 @@
 #include "rl2_image.h"
 #include "rl2_log.h"
 #include "rl2_heap.h"
+#include "rl2_jobs.h"
+#include "rl2_span.h"
 
 #include <stdlib.h>
 #include <string.h>
 
 #define TAG "IMG "
 
-typedef uint16_t rl2_Rle;
+// The colors are stored inline with the RLE operations, so RLE words are as wide as the canvas pixels
+typedef rl2_Pixel rl2_Rle;
 
-// Make sure the build fails if rl2_Rle is not big enough for a rl2_RGB565
-typedef char rl2_staticAssertRleMustBeBigEnoughForRGB565[sizeof(rl2_Rle) >= sizeof(rl2_RGB565) ? 1 : -1];
+// Make sure the build fails if rl2_Rle is not big enough for the RLE operations
+typedef char rl2_staticAssertRleMustHaveAtLeast16Bits[sizeof(rl2_Rle) >= 2 ? 1 : -1];
 
 typedef enum {
     // RLE is 6 bits for inverse alpha || 8 bits for length - 1 || 2 bits for operation followed by the colors
@@ -24,10 +27,95 @@ typedef enum {
 }
 rl2_RleOp;
 
+// Wide images get a checkpoint every 64 pixels in each row, so that left clipping doesn't have to walk all the
+// RLE operations up to the first visible pixel
+#define RL2_CHECKPOINT_SHIFT 6
+#define RL2_CHECKPOINT_MIN_WIDTH 256
+
+// Serialized images start with this header, followed by the offset in words of each row from the start of the RLE
+// words as 32-bit integers, the RLE words padded to a multiple of four bytes, and the checkpoints; all little-endian.
+// RLE words have 16 bits, or 32 with RL2_IMAGE_XRGB8888 which must match the canvas format. With RL2_IMAGE_TRIMMED
+// the header is followed by an rl2_ImageTrim, and width and height are the size of the encoded pixels
+#define RL2_IMAGE_MAGIC "RL2I"
+#define RL2_IMAGE_VERSION 1
+#define RL2_IMAGE_HAS_CHECKPOINTS 1
+#define RL2_IMAGE_XRGB8888 2
+#define RL2_IMAGE_TRIMMED 4
+
+#ifdef RL2_PIXEL_XRGB8888
+#define RL2_IMAGE_PIXEL_FORMAT RL2_IMAGE_XRGB8888
+#else
+#define RL2_IMAGE_PIXEL_FORMAT 0
+#endif
+
+typedef struct {
+    char magic[4];
+    uint16_t version;
+    uint16_t flags;
+    uint32_t width;
+    uint32_t height;
+    uint32_t pixels_used;
+    uint32_t num_words;
+}
+rl2_ImageHeader;
+
+typedef char rl2_staticAssertImageHeaderHas24Bytes[sizeof(rl2_ImageHeader) == 24 ? 1 : -1];
+
+typedef struct {
+    uint32_t left;
+    uint32_t top;
+    uint32_t full_width;
+    uint32_t full_height;
+}
+rl2_ImageTrim;
+
+// Rows are encoded in batches, each one a job for the workers
+#define RL2_ROWS_PER_JOB 16
+
+// What the blitters can assume about the image, found once when it's created
+typedef enum {
+    // Any mix of RLE operations
+    RL2_IMAGE_SPARSE = 0,
+
+    // Only RL2_RLE_SKIP and RL2_RLE_BLIT operations, no alpha blending
+    RL2_IMAGE_NO_COMPOSE,
+
+    // Each row is a single RL2_RLE_BLIT operation, so the colors of a row can be copied straight to the canvas
+    RL2_IMAGE_OPAQUE
+}
+rl2_ImageKind;
+
+typedef struct {
+    uint32_t offset; // offset in words, from the start of the row, of the RLE operation covering the pixel
+    uint32_t x;      // first pixel covered by that RLE operation
+}
+rl2_Checkpoint;
+
+typedef struct {
+    rl2_Rle const* rle;
+    rl2_RleOp op;
+    unsigned length;
+    uint8_t inv_alpha;
+}
+rl2_RleCursor;
+
 struct rl2_Image {
+    // Size of the encoded pixels, which start at (left, top) in an image of full_width by full_height pixels when
+    // the transparent borders were trimmed
     unsigned width;
     unsigned height;
+    unsigned left;
+    unsigned top;
+    unsigned full_width;
+    unsigned full_height;
+
     size_t pixels_used;
+    bool packed; // created by rl2_createImages with other images in the same block
+    rl2_ImageKind kind;
+    rl2_ImageRect opaque; // largest rectangle of opaque pixels, width and height are 0 if there's none
+
+    // NULL, or height rows with (width + 63) / 64 checkpoints each
+    rl2_Checkpoint const* checkpoints;
 
 #ifdef RL2_BUILD_DEBUG
     char const* path;
@@ -52,29 +140,24 @@ static uint8_t rl2_rleInvAlpha(rl2_Rle const rle) {
     return rle >> 10;
 }
 
-static void rl2_rleRowDryRun(size_t* const words_used, size_t* const pixels_used, rl2_PixelSource const source, int const y) {
-    unsigned const width = rl2_pixelSourceWidth(source);
+static unsigned rl2_rleRun(uint8_t const* const levels, unsigned const x, unsigned const width) {
+    uint8_t const level = levels[x];
+    unsigned xx = x + 1;
+
+    while (xx < width && levels[xx] == level) {
+        xx++;
+    }
+
+    return xx - x;
+}
 
+static void rl2_rleRowSize(size_t* const words_used, size_t* const pixels_used, uint8_t const* const levels, unsigned const width) {
     *words_used = 0;
     *pixels_used = 0;
 
     for (unsigned x = 0; x < width;) {
-        rl2_ARGB8888 const pixel = rl2_getPixel(source, x, y);
-        uint8_t const alpha = RL2_ARGB8888_A(pixel);
-        uint8_t const real_alpha = ((uint16_t)alpha + 4) / 8;
-        unsigned xx = x + 1;
-
-        for (; xx < width; xx++) {
-            rl2_ARGB8888 const pixel2 = rl2_getPixel(source, xx, y);
-            uint8_t const alpha2 = RL2_ARGB8888_A(pixel2);
-            uint8_t const real_alpha2 = ((uint16_t)alpha2 + 4) / 8;
-
-            if (real_alpha2 != real_alpha) {
-                break;
-            }
-        }
-
-        unsigned const length = xx - x;
+        uint8_t const real_alpha = levels[x];
+        unsigned const length = rl2_rleRun(levels, x, width);
 
         if (real_alpha == 0) {
             // RL2_RLE_SKIP
@@ -93,452 +176,1576 @@ static void rl2_rleRowDryRun(size_t* const words_used, size_t* const pixels_used
             *pixels_used += length;             // overwrites length pixels of the canvas
         }
 
-        x = xx;
+        x += length;
     }
 }
 
-static size_t rl2_rleRow(rl2_Rle* rle, rl2_PixelSource const source, int const y) {
-    unsigned const width = rl2_pixelSourceWidth(source);
-
-    size_t words_used = 0;
+static size_t rl2_rleRow(rl2_Rle* rle, rl2_ARGB8888 const* const row, uint8_t const* const levels, unsigned const width) {
+    rl2_Rle* const start = rle;
 
     for (unsigned x = 0; x < width;) {
-        rl2_ARGB8888 const pixel = rl2_getPixel(source, x, y);
-        uint8_t const alpha = RL2_ARGB8888_A(pixel);
-        uint8_t const real_alpha = ((uint16_t)alpha + 4) / 8;
-        unsigned xx = x + 1;
-
-        for (; xx < width; xx++) {
-            rl2_ARGB8888 const pixel2 = rl2_getPixel(source, xx, y);
-            uint8_t const alpha2 = RL2_ARGB8888_A(pixel2);
-            uint8_t const real_alpha2 = ((uint16_t)alpha2 + 4) / 8;
-
-            if (real_alpha2 != real_alpha) {
-                break;
-            }
-        }
-
-        unsigned length = xx - x;
+        uint8_t const real_alpha = levels[x];
+        unsigned length = rl2_rleRun(levels, x, width);
+        unsigned xx = x;
 
         if (real_alpha == 0) {
             // RL2_RLE_SKIP
-            words_used += (length + 16383) / 16384;
-
             while (length != 0) {
                 unsigned const count = length < 16384 ? length : 16384;
                 *rle++ = rl2_rle(RL2_RLE_SKIP, count, 0);
                 length -= count;
+                xx += count;
             }
         }
         else if (real_alpha == 32) {
             // RL2_RLE_BLIT
-            words_used += (length + 16383) / 16384;
-            words_used += length;
-
             while (length != 0) {
                 unsigned const count = length < 16384 ? length : 16384;
                 *rle++ = rl2_rle(RL2_RLE_BLIT, count, 0);
 
-                for (unsigned i = 0; i < count; i++) {
-                    rl2_ARGB8888 const pixel2 = rl2_getPixel(source, x + i, y);
-                    uint8_t const r = RL2_ARGB8888_R(pixel2);
-                    uint8_t const g = RL2_ARGB8888_G(pixel2);
-                    uint8_t const b = RL2_ARGB8888_B(pixel2);
-                    *rle++ = RL2_COLOR_RGB565(r, g, b);
-                }
+                rl2_convertSpan(rle, row + xx, count);
+                rle += count;
 
                 length -= count;
+                xx += count;
             }
         }
         else {
-            // RL2_RLE_COMPOSE
+            // RL2_RLE_COMPOSE, all colors are premultiplied by the alpha of the first pixel in the run
+            uint8_t const alpha = RL2_ARGB8888_A(row[x]);
             uint8_t const inv_alpha = 32 - real_alpha;
-            words_used += (length + 255) / 256;
-            words_used += length;
 
             while (length != 0) {
                 unsigned const count = length < 256 ? length : 256;
                 *rle++ = rl2_rle(RL2_RLE_COMPOSE, count, inv_alpha);
 
-                for (unsigned i = 0; i < count; i++) {
-                    rl2_ARGB8888 const pixel2 = rl2_getPixel(source, x + i, y);
-                    uint8_t const r = RL2_ARGB8888_R(pixel2) * alpha / 255;
-                    uint8_t const g = RL2_ARGB8888_G(pixel2) * alpha / 255;
-                    uint8_t const b = RL2_ARGB8888_B(pixel2) * alpha / 255;
-                    *rle++ = RL2_COLOR_RGB565(r, g, b);
-                }
+                rl2_premultiplySpan(rle, row + xx, count, alpha);
+                rle += count;
 
                 length -= count;
+                xx += count;
             }
         }
 
         x = xx;
     }
 
-    return words_used;
+    return rle - start;
 }
 
-static rl2_RGB565 rl2_compose(rl2_RGB565 const src, rl2_RGB565 const dst, uint8_t const inv_alpha) {
-    uint32_t const src32 = (src & 0xf81fU) | (uint32_t)(src & 0x07e0U) << 16;
-    uint32_t const dst32 = (dst & 0xf81fU) | (uint32_t)(dst & 0x07e0U) << 16;
-    uint32_t const composed = src32 + (dst32 * inv_alpha) / 32;
-    return (composed & 0xf81fU) | ((composed >> 16) & 0x07e0U);
+static unsigned rl2_checkpointsPerRow(unsigned const width) {
+    return (width + (1U << RL2_CHECKPOINT_SHIFT) - 1) >> RL2_CHECKPOINT_SHIFT;
 }
 
-rl2_Image rl2_createImage(rl2_PixelSource const source) {
-    size_t total_words_used = 0;
-    size_t total_pixels_used = 0;
+static void rl2_indexRow(rl2_Checkpoint* const checkpoints, rl2_Rle const* const row, unsigned const width) {
+    rl2_Rle const* rle = row;
+    unsigned const count = rl2_checkpointsPerRow(width);
 
-    unsigned const height = rl2_pixelSourceHeight(source);
+    for (unsigned x = 0, i = 0; i < count;) {
+        rl2_RleOp const op = rl2_rleOp(*rle);
+        unsigned const length = rl2_rleLength(*rle);
 
-    for (unsigned y = 0; y < height; y++) {
-        size_t words_used = 0, pixels_used = 0;
-        rl2_rleRowDryRun(&words_used, &pixels_used, source, y);
+        // Record this operation for all checkpoints that fall inside it
+        for (; i < count && (i << RL2_CHECKPOINT_SHIFT) < x + length; i++) {
+            checkpoints[i].offset = (uint32_t)(rle - row);
+            checkpoints[i].x = x;
+        }
 
-        total_words_used += words_used;
-        total_pixels_used += pixels_used;
+        rle += 1 + (op != RL2_RLE_SKIP ? length : 0);
+        x += length;
     }
+}
 
-    rl2_Image const image = (rl2_Image)rl2_alloc(sizeof(*image) + sizeof(image->rows[0]) * (height - 1) + total_words_used * 2);
+// Checks that the checkpoints of a validated row are the ones rl2_indexRow would write, rl2_rleSeek trusts them
+static bool rl2_checkpointsValid(rl2_Checkpoint const* const checkpoints, rl2_Rle const* const row, unsigned const width) {
+    rl2_Rle const* rle = row;
+    unsigned const count = rl2_checkpointsPerRow(width);
 
-    if (image == NULL) {
-        RL2_ERROR(TAG "out of memory");
-        return NULL;
+    for (unsigned x = 0, i = 0; i < count;) {
+        rl2_RleOp const op = rl2_rleOp(*rle);
+        unsigned const length = rl2_rleLength(*rle);
+
+        for (; i < count && (i << RL2_CHECKPOINT_SHIFT) < x + length; i++) {
+            if (checkpoints[i].offset != (uint32_t)(rle - row) || checkpoints[i].x != x) {
+                return false;
+            }
+        }
+
+        rle += 1 + (op != RL2_RLE_SKIP ? length : 0);
+        x += length;
     }
 
-    image->width = rl2_pixelSourceWidth(source);
-    image->height = height;
-    image->pixels_used = total_pixels_used;
+    return true;
+}
 
-    rl2_Rle* rle = (rl2_Rle*)((uint8_t*)image + sizeof(*image) + sizeof(image->rows[0]) * (height - 1));
+static void rl2_rleFetch(rl2_RleCursor* const cursor) {
+    rl2_Rle const rle = *cursor->rle++;
+    cursor->op = rl2_rleOp(rle);
+    cursor->length = rl2_rleLength(rle);
+    cursor->inv_alpha = rl2_rleInvAlpha(rle);
+}
 
-    for (unsigned y = 0; y < height; y++) {
-        image->rows[y] = rle;
-        size_t const words_used = rl2_rleRow(rle, source, y);
-        rle += words_used;
+static void rl2_rleSeek(rl2_RleCursor* const cursor, rl2_Image const image, unsigned const y, unsigned skip) {
+    cursor->rle = image->rows[y];
+
+    if (image->checkpoints != NULL && skip >= (1U << RL2_CHECKPOINT_SHIFT)) {
+        // Jump straight to the RLE operation covering the last checkpoint before the first visible pixel
+        rl2_Checkpoint const* const checkpoint =
+            image->checkpoints + (size_t)y * rl2_checkpointsPerRow(image->width) + (skip >> RL2_CHECKPOINT_SHIFT);
+
+        cursor->rle += checkpoint->offset;
+        skip -= checkpoint->x;
     }
 
-#ifdef RL2_BUILD_DEBUG
-    char const* const path = rl2_getPixelSourcePath(source);
+    rl2_rleFetch(cursor);
 
-    if (path != NULL) {
-        size_t const path_len = strlen(path);
-        char* const path_dup = (char*)rl2_alloc(path_len + 1);
-        image->path = path_dup;
+    // Skip pixels to the left
+    while (skip != 0) {
+        unsigned const count = cursor->length <= skip ? cursor->length : skip;
+
+        if (cursor->op != RL2_RLE_SKIP) {
+            // Also skip colors
+            cursor->rle += count;
+        }
 
-        if (path_dup != NULL) {
-            memcpy(path_dup, path, path_len + 1);
+        cursor->length -= count;
+        skip -= count;
+
+        if (cursor->length == 0) {
+            // End of this RLE operation, fetch the next one
+            rl2_rleFetch(cursor);
         }
     }
-    else {
-        image->path = NULL;
+}
+
+static rl2_ImageKind rl2_classifyImage(rl2_Image const image) {
+    unsigned const width = image->width;
+    bool opaque = true;
+
+    for (unsigned y = 0; y < image->height; y++) {
+        rl2_Rle const* rle = image->rows[y];
+
+        opaque = opaque && rl2_rleOp(*rle) == RL2_RLE_BLIT && rl2_rleLength(*rle) == width;
+
+        for (unsigned x = 0; x < width;) {
+            rl2_RleOp const op = rl2_rleOp(*rle);
+            unsigned const length = rl2_rleLength(*rle);
+
+            if (op == RL2_RLE_COMPOSE) {
+                return RL2_IMAGE_SPARSE;
+            }
+
+            rle += 1 + (op != RL2_RLE_SKIP ? length : 0);
+            x += length;
+        }
     }
-#endif
 
-    return image;
+    return opaque ? RL2_IMAGE_OPAQUE : RL2_IMAGE_NO_COMPOSE;
 }
 
-void rl2_destroyImage(rl2_Image const image) {
-#ifdef RL2_BUILD_DEBUG
-    rl2_free((void*)image->path);
-#endif
+// Finds the largest rectangle covered by RL2_RLE_BLIT operations, going down the rows with the number of opaque
+// pixels above each column and finding the largest rectangle under that histogram with a stack of columns
+static void rl2_findOpaqueRect(rl2_Image const image) {
+    unsigned const width = image->width;
+    rl2_ImageRect* const best = &image->opaque;
 
-    rl2_free(image);
-}
+    best->x0 = best->y0 = best->width = best->height = 0;
 
-unsigned rl2_imageWidth(rl2_Image const image) {
-    return image->width;
-}
+    if (image->kind == RL2_IMAGE_OPAQUE) {
+        best->width = width;
+        best->height = image->height;
+        return;
+    }
 
-unsigned rl2_imageHeight(rl2_Image const image) {
-    return image->height;
-}
+    unsigned* const heights = (unsigned*)rl2_alloc(sizeof(unsigned) * (width + 1) * 2);
 
-size_t rl2_changedPixels(rl2_Image const image) {
-    return image->pixels_used;
-}
+    if (heights == NULL) {
+        // Not finding it only means nothing is culled behind the image
+        RL2_WARN(TAG "out of memory, image won't hide sprites behind it");
+        return;
+    }
 
-static bool rl2_clip(
-    rl2_Image const image, rl2_Canvas const canvas, int* const x0, int* const y0, unsigned* const width, unsigned* const height) {
+    unsigned* const stack = heights + width + 1;
+    memset(heights, 0, sizeof(unsigned) * (width + 1));
 
-    unsigned const image_width = rl2_imageWidth(image);
-    unsigned const image_height = rl2_imageHeight(image);
+    for (unsigned y = 0; y < image->height; y++) {
+        rl2_Rle const* rle = image->rows[y];
 
-    unsigned const canvas_width = rl2_canvasWidth(canvas);
-    unsigned const canvas_height = rl2_canvasHeight(canvas);
+        for (unsigned x = 0; x < width;) {
+            rl2_RleOp const op = rl2_rleOp(*rle);
+            unsigned const length = rl2_rleLength(*rle);
 
-    if (*x0 < 0) {
-        if ((unsigned)(-*x0) > image_width) {
-            return false;
+            for (unsigned const end = x + length; x < end; x++) {
+                heights[x] = op == RL2_RLE_BLIT ? heights[x] + 1 : 0;
+            }
+
+            rle += 1 + (op != RL2_RLE_SKIP ? length : 0);
         }
-    }
-    else if ((unsigned)(*x0) >= canvas_width) {
-        return false;
-    }
 
-    if (*y0 < 0) {
-        if ((unsigned)(-*y0) > image_height) {
-            return false;
+        // heights[width] is always 0 and empties the stack at the end of the row
+        size_t top = 0;
+
+        for (unsigned x = 0; x <= width; x++) {
+            while (top != 0 && heights[stack[top - 1]] >= heights[x]) {
+                unsigned const height = heights[stack[--top]];
+                unsigned const left = top != 0 ? stack[top - 1] + 1 : 0;
+
+                if ((size_t)height * (x - left) > (size_t)best->width * best->height) {
+                    best->x0 = left;
+                    best->y0 = y + 1 - height;
+                    best->width = x - left;
+                    best->height = height;
+                }
+            }
+
+            stack[top++] = x;
         }
     }
-    else if ((unsigned)(*y0) >= canvas_height) {
-        return false;
-    }
 
-    *width = image_width;
-    *height = image_height;
+    rl2_free(heights);
+}
 
-    if (*x0 < 0) {
-        // Left clip, decrease total width and start at x0 = 0
-        *width += *x0;
-        *x0 = 0;
-    }
+typedef struct {
+    rl2_ARGB8888 const* pixels;
+    uint8_t* levels;
+    unsigned width;
 
-    if (*x0 + *width > canvas_width) {
-        // Right clip, decrease total width
-        *width = canvas_width - *x0;
-    }
+    size_t words_used;
+    size_t pixels_used;
+
+    rl2_Rle* rle;
+    rl2_Checkpoint* checkpoints;
+}
+rl2_RowEncoder;
+
+typedef struct {
+    rl2_RowEncoder* rows;
+    size_t count;
+}
+rl2_RowEncoders;
+
+static void rl2_sizeRows(void* const userdata, size_t const index) {
+    rl2_RowEncoders const* const encoders = (rl2_RowEncoders const*)userdata;
+    size_t const first = index * RL2_ROWS_PER_JOB;
+    size_t const last = first + RL2_ROWS_PER_JOB < encoders->count ? first + RL2_ROWS_PER_JOB : encoders->count;
 
-    if (*y0 < 0) {
-        // Top clip, decrease total height and start at y0 = 0
-        *height += *y0;
-        *y0 = 0;
+    for (size_t i = first; i < last; i++) {
+        rl2_RowEncoder* const row = encoders->rows + i;
+        rl2_alphaLevels(row->levels, row->pixels, row->width);
+        rl2_rleRowSize(&row->words_used, &row->pixels_used, row->levels, row->width);
     }
+}
 
-    if (*y0 + *height > canvas_height) {
-        // Bottom clip, decrease total height
-        *height = canvas_height - *y0;
+static void rl2_encodeRows(void* const userdata, size_t const index) {
+    rl2_RowEncoders const* const encoders = (rl2_RowEncoders const*)userdata;
+    size_t const first = index * RL2_ROWS_PER_JOB;
+    size_t const last = first + RL2_ROWS_PER_JOB < encoders->count ? first + RL2_ROWS_PER_JOB : encoders->count;
+
+    for (size_t i = first; i < last; i++) {
+        rl2_RowEncoder const* const row = encoders->rows + i;
+        rl2_rleRow(row->rle, row->pixels, row->levels, row->width);
+
+        if (row->checkpoints != NULL) {
+            rl2_indexRow(row->checkpoints, row->rle, row->width);
+        }
     }
+}
 
-    return true;
+// Pixels with alpha below 4 get alpha level 0 and are encoded as RL2_RLE_SKIP, trimming removes the rows and columns
+// made only of those
+static bool rl2_isVisible(rl2_ARGB8888 const pixel) {
+    return RL2_ARGB8888_A(pixel) >= 4;
 }
 
-rl2_RGB565* rl2_blit(rl2_Image const image, rl2_Canvas const canvas, int const x0, int const y0, rl2_RGB565* bg) {
-    int new_x0 = x0, new_y0 = y0;
-    unsigned width, height;
-    
-    // Clip the image to the canvas
-    if (!rl2_clip(image, canvas, &new_x0, &new_y0, &width, &height)) {
-        // Image is not visible
-        return bg;
-    }
+static void rl2_trimRect(rl2_ImageRect* const trimmed, rl2_PixelSource const source, rl2_ImageRect const* const rect) {
+    unsigned left = rect->width, right = 0, top = rect->height, bottom = 0;
 
-    // Evaluate the pixel on the canvas to blit to
-    rl2_RGB565* pixel = rl2_canvasPixel(canvas, new_x0, new_y0);
-    size_t const pitch = rl2_canvasPitch(canvas);
+    for (unsigned y = 0; y < rect->height; y++) {
+        rl2_ARGB8888 const* const row = rl2_pixelSourceRow(source, rect->y0 + y) + rect->x0;
+        unsigned first = 0, last = rect->width;
 
-    for (unsigned y = 0; y < height; y++) {
-        rl2_RGB565* const saved_pixel = pixel;
-        rl2_Rle const* rle = image->rows[new_y0 - y0 + y];
+        while (first < rect->width && !rl2_isVisible(row[first])) {
+            first++;
+        }
 
-        rl2_RleOp op = rl2_rleOp(*rle);
-        unsigned length = rl2_rleLength(*rle);
-        uint8_t inv_alpha = rl2_rleInvAlpha(*rle);
-        rle++;
+        if (first == rect->width) {
+            // Nothing visible in this row
+            continue;
+        }
 
-        // Skip pixels to the left
-        for (unsigned skip = new_x0 - x0; skip != 0;) {
-            unsigned const count = length <= skip ? length : skip;
+        // Only look for the last visible pixel as far as the right edge found so far
+        while (last > right && !rl2_isVisible(row[last - 1])) {
+            last--;
+        }
 
-            if (op != RL2_RLE_SKIP) {
-                // Also skip colors
-                rle += count;
-            }
+        left = first < left ? first : left;
+        right = last > right ? last : right;
+        top = y < top ? y : top;
+        bottom = y + 1;
+    }
 
-            length -= count;
-            skip -= count;
+    if (top == rect->height) {
+        // Fully transparent, keep one pixel so the image isn't empty
+        left = top = 0;
+        right = bottom = 1;
+    }
 
-            if (length == 0) {
-                // End of this RLE operation, fetch the next one
-                op = rl2_rleOp(*rle);
-                length = rl2_rleLength(*rle);
-                inv_alpha = rl2_rleInvAlpha(*rle);
-                rle++;
-            }
-        }
+    trimmed->x0 = rect->x0 + left;
+    trimmed->y0 = rect->y0 + top;
+    trimmed->width = right - left;
+    trimmed->height = bottom - top;
+}
 
-        // Write the remaining pixels
-        for (unsigned remaining = width; remaining != 0;) {
-            unsigned const count = length <= remaining ? length : remaining;
+static bool rl2_encodeImages(
+    rl2_Image* const images, rl2_PixelSource const source, rl2_ImageRect const* const rects, size_t const count,
+    bool const packed, bool const trim) {
 
-            if (op == RL2_RLE_BLIT) {
-                // Save the overwritten pixels
-                memcpy(bg, pixel, count * sizeof(*bg));
-                bg += count;
+    unsigned const source_width = rl2_pixelSourceWidth(source);
+    unsigned const source_height = rl2_pixelSourceHeight(source);
 
-                // Blit the image pixels
-                memcpy(pixel, rle, count * sizeof(*pixel));
-                rle += count;
-            }
-            else if (op == RL2_RLE_COMPOSE) {
-                // Save the overwritten pixels
-                memcpy(bg, pixel, count * sizeof(*bg));
-                bg += count;
+    size_t total_rows = 0;
+    size_t total_pixels = 0;
 
-                // Compose the image pixels
-                for (unsigned i = 0; i < count; i++) {
-                    pixel[i] = rl2_compose(*rle, pixel[i], inv_alpha);
-                    rle++;
-                }
-            }
+    for (size_t i = 0; i < count; i++) {
+        rl2_ImageRect const* const rect = rects + i;
 
-            length -= count;
-            remaining -= count;
-            pixel += count;
+        if (rect->width == 0 || rect->height == 0 ||
+            rect->x0 + rect->width > source_width || rect->y0 + rect->height > source_height) {
 
-            if (length == 0) {
-                // End of this RLE operation, fetch the next one
-                op = rl2_rleOp(*rle);
-                length = rl2_rleLength(*rle);
-                inv_alpha = rl2_rleInvAlpha(*rle);
-                rle++;
-            }
-        }
+            RL2_ERROR(
+                TAG "invalid image rectangle %u, %u, %u, %u", rect->x0, rect->y0, rect->width, rect->height);
 
-        pixel = (rl2_RGB565*)((uint8_t*)saved_pixel + pitch);
+            return false;
+        }
     }
 
-    return bg;
-}
+    // Trimmed rectangles are encoded in place of the ones asked for
+    rl2_ImageRect* trimmed = NULL;
 
-void rl2_unblit(rl2_Image const image, rl2_Canvas const canvas, int const x0, int const y0, rl2_RGB565 const* bg) {
-    int new_x0 = x0, new_y0 = y0;
-    unsigned width, height;
-    
-    // Clip the image to the canvas
-    if (!rl2_clip(image, canvas, &new_x0, &new_y0, &width, &height)) {
-        // Image is not visible
-        return;
+    if (trim) {
+        trimmed = (rl2_ImageRect*)rl2_alloc(count * sizeof(*trimmed));
+
+        if (trimmed == NULL) {
+            RL2_ERROR(TAG "out of memory");
+            return false;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            rl2_trimRect(trimmed + i, source, rects + i);
+        }
     }
 
-    // Evaluate the pixel on the canvas to blit to
-    rl2_RGB565* pixel = rl2_canvasPixel(canvas, new_x0, new_y0);
-    size_t const pitch = rl2_canvasPitch(canvas);
+    rl2_ImageRect const* const encoded = trim ? trimmed : rects;
 
-    for (unsigned y = 0; y < height; y++) {
-        rl2_RGB565* const saved_pixel = pixel;
-        rl2_Rle const* rle = image->rows[new_y0 - y0 + y];
+    for (size_t i = 0; i < count; i++) {
+        total_rows += encoded[i].height;
+        total_pixels += (size_t)encoded[i].width * encoded[i].height;
+    }
 
-        rl2_RleOp op = rl2_rleOp(*rle);
-        unsigned length = rl2_rleLength(*rle);
-        rle++;
+    // Work area with the state of each row and the quantized alpha of all pixels, computed once by the sizing pass
+    // and reused by the encoding pass
+    rl2_RowEncoders encoders;
+    encoders.rows = (rl2_RowEncoder*)rl2_alloc(total_rows * sizeof(rl2_RowEncoder) + total_pixels);
+    encoders.count = total_rows;
 
-        // Skip pixels to the left
-        for (unsigned skip = new_x0 - x0; skip != 0;) {
-            unsigned const count = length <= skip ? length : skip;
+    if (encoders.rows == NULL) {
+        RL2_ERROR(TAG "out of memory");
+        rl2_free(trimmed);
+        return false;
+    }
 
-            if (op != RL2_RLE_SKIP) {
-                // Also skip colors
-                rle += count;
-            }
+    uint8_t* levels = (uint8_t*)(encoders.rows + total_rows);
+    rl2_RowEncoder* row = encoders.rows;
 
-            length -= count;
-            skip -= count;
+    for (size_t i = 0; i < count; i++) {
+        rl2_ImageRect const* const rect = encoded + i;
 
-            if (length == 0) {
-                // End of this RLE operation, fetch the next one
-                op = rl2_rleOp(*rle);
-                length = rl2_rleLength(*rle);
-                rle++;
-            }
+        for (unsigned y = 0; y < rect->height; y++, row++) {
+            row->pixels = rl2_pixelSourceRow(source, rect->y0 + y) + rect->x0;
+            row->levels = levels;
+            row->width = rect->width;
+            levels += rect->width;
         }
+    }
 
-        // Restore the remaining pixels
-        for (unsigned remaining = width; remaining != 0;) {
-            unsigned const count = length <= remaining ? length : remaining;
+    size_t const num_jobs = (total_rows + RL2_ROWS_PER_JOB - 1) / RL2_ROWS_PER_JOB;
+    rl2_parallelFor(rl2_sizeRows, &encoders, num_jobs);
 
-            if (op != RL2_RLE_SKIP) {
-                // Restore the overwritten pixels
-                memcpy(pixel, bg, count * sizeof(*bg));
-                bg += count;
-                rle += count;
-            }
+    // Lay out all images one after the other in a single block, each with its row pointers, RLE words and
+    // checkpoints, followed by the path of the source in debug builds
+    size_t block_size = 0;
+    row = encoders.rows;
 
-            length -= count;
-            remaining -= count;
-            pixel += count;
+    for (size_t i = 0; i < count; i++) {
+        rl2_ImageRect const* const rect = encoded + i;
+        size_t words_used = 0;
 
-            if (length == 0) {
-                // End of this RLE operation, fetch the next one
-                op = rl2_rleOp(*rle);
-                length = rl2_rleLength(*rle);
-                rle++;
-            }
+        for (unsigned y = 0; y < rect->height; y++, row++) {
+            words_used += row->words_used;
         }
 
-        pixel = (rl2_RGB565*)((uint8_t*)saved_pixel + pitch);
-    }
-}
+        size_t const checkpoints_count =
+            rect->width >= RL2_CHECKPOINT_MIN_WIDTH ? (size_t)rl2_checkpointsPerRow(rect->width) * rect->height : 0;
 
-void rl2_stamp(rl2_Image const image, rl2_Canvas const canvas, int const x0, int const y0) {
-    // This is identical to rl2_blit, except overwritten pixels aren't saved
-    int new_x0 = x0, new_y0 = y0;
-    unsigned width, height;
-    
-    if (!rl2_clip(image, canvas, &new_x0, &new_y0, &width, &height)) {
-        return;
+        block_size += sizeof(struct rl2_Image) + sizeof(rl2_Rle const*) * (rect->height - 1);
+        block_size += (words_used * sizeof(rl2_Rle) + 3) & ~(size_t)3;
+        block_size += checkpoints_count * sizeof(rl2_Checkpoint);
+        block_size = (block_size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
     }
 
-    rl2_RGB565* pixel = rl2_canvasPixel(canvas, new_x0, new_y0);
-    size_t const pitch = rl2_canvasPitch(canvas);
+#ifdef RL2_BUILD_DEBUG
+    char const* const path = rl2_getPixelSourcePath(source);
+    size_t const path_size = path != NULL ? strlen(path) + 1 : 0;
+    block_size += path_size;
+#endif
 
-    for (unsigned y = 0; y < height; y++) {
-        rl2_RGB565* const saved_pixel = pixel;
-        rl2_Rle const* rle = image->rows[new_y0 - y0 + y];
+    uint8_t* block = (uint8_t*)rl2_alloc(block_size);
 
-        rl2_RleOp op = rl2_rleOp(*rle);
-        unsigned length = rl2_rleLength(*rle);
-        uint8_t inv_alpha = rl2_rleInvAlpha(*rle);
-        rle++;
+    if (block == NULL) {
+        RL2_ERROR(TAG "out of memory");
+        rl2_free(encoders.rows);
+        rl2_free(trimmed);
+        return false;
+    }
 
-        for (unsigned skip = new_x0 - x0; skip != 0;) {
-            unsigned const count = length <= skip ? length : skip;
+    row = encoders.rows;
 
-            if (op != RL2_RLE_SKIP) {
-                rle += count;
-            }
+    for (size_t i = 0; i < count; i++) {
+        rl2_ImageRect const* const rect = encoded + i;
+        rl2_Image const image = (rl2_Image)block;
 
-            length -= count;
-            skip -= count;
+        image->width = rect->width;
+        image->height = rect->height;
+        image->left = rect->x0 - rects[i].x0;
+        image->top = rect->y0 - rects[i].y0;
+        image->full_width = rects[i].width;
+        image->full_height = rects[i].height;
+        image->pixels_used = 0;
+        image->packed = packed;
 
-            if (length == 0) {
-                op = rl2_rleOp(*rle);
-                length = rl2_rleLength(*rle);
-                inv_alpha = rl2_rleInvAlpha(*rle);
-                rle++;
-            }
+        block += sizeof(struct rl2_Image) + sizeof(rl2_Rle const*) * (rect->height - 1);
+        rl2_Rle* rle = (rl2_Rle*)block;
+
+        for (unsigned y = 0; y < rect->height; y++) {
+            image->rows[y] = row[y].rle = rle;
+            image->pixels_used += row[y].pixels_used;
+            rle += row[y].words_used;
         }
 
-        for (unsigned remaining = width; remaining != 0;) {
-            unsigned const count = length <= remaining ? length : remaining;
+        block = (uint8_t*)(((uintptr_t)rle + 3) & ~(uintptr_t)3);
 
-            if (op == RL2_RLE_BLIT) {
-                memcpy(pixel, rle, count * sizeof(*pixel));
-                rle += count;
-            }
-            else if (op == RL2_RLE_COMPOSE) {
-                for (unsigned i = 0; i < count; i++) {
-                    pixel[i] = rl2_compose(*rle, pixel[i], inv_alpha);
-                    rle++;
-                }
+        if (rect->width >= RL2_CHECKPOINT_MIN_WIDTH) {
+            rl2_Checkpoint* const checkpoints = (rl2_Checkpoint*)block;
+            unsigned const per_row = rl2_checkpointsPerRow(rect->width);
+            image->checkpoints = checkpoints;
+
+            for (unsigned y = 0; y < rect->height; y++) {
+                row[y].checkpoints = checkpoints + (size_t)y * per_row;
             }
 
-            length -= count;
-            remaining -= count;
-            pixel += count;
+            block += (size_t)per_row * rect->height * sizeof(rl2_Checkpoint);
+        }
+        else {
+            image->checkpoints = NULL;
 
-            if (length == 0) {
-                op = rl2_rleOp(*rle);
-                length = rl2_rleLength(*rle);
-                inv_alpha = rl2_rleInvAlpha(*rle);
-                rle++;
+            for (unsigned y = 0; y < rect->height; y++) {
+                row[y].checkpoints = NULL;
             }
         }
 
-        pixel = (rl2_RGB565*)((uint8_t*)saved_pixel + pitch);
+        block = (uint8_t*)(((uintptr_t)block + sizeof(void*) - 1) & ~(uintptr_t)(sizeof(void*) - 1));
+        row += rect->height;
+        images[i] = image;
+    }
+
+#ifdef RL2_BUILD_DEBUG
+    char* const path_dup = path != NULL ? (char*)block : NULL;
+
+    if (path_dup != NULL) {
+        memcpy(path_dup, path, path_size);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        images[i]->path = path_dup;
+    }
+#endif
+
+    rl2_parallelFor(rl2_encodeRows, &encoders, num_jobs);
+
+    for (size_t i = 0; i < count; i++) {
+        images[i]->kind = rl2_classifyImage(images[i]);
+        rl2_findOpaqueRect(images[i]);
+    }
+
+    rl2_free(encoders.rows);
+    rl2_free(trimmed);
+    return true;
+}
+
+static rl2_Image rl2_createSingleImage(rl2_PixelSource const source, bool const trim) {
+    rl2_ImageRect rect;
+    rect.x0 = rect.y0 = 0;
+    rect.width = rl2_pixelSourceWidth(source);
+    rect.height = rl2_pixelSourceHeight(source);
+
+    rl2_Image image = NULL;
+
+    if (!rl2_encodeImages(&image, source, &rect, 1, false, trim)) {
+        // Error already logged
+        return NULL;
     }
+
+    return image;
 }
 
+rl2_Image rl2_createImage(rl2_PixelSource const source) {
+    return rl2_createSingleImage(source, false);
+}
+
+rl2_Image rl2_createTrimmedImage(rl2_PixelSource const source) {
+    return rl2_createSingleImage(source, true);
+}
+
+bool rl2_createImages(
+    rl2_Image* const images, rl2_PixelSource const source, rl2_ImageRect const* const rects, size_t const count,
+    bool const trim) {
+
+    if (count == 0) {
+        return true;
+    }
+
+    return rl2_encodeImages(images, source, rects, count, true, trim);
+}
+
+bool rl2_createImageGrid(
+    rl2_Image* const images, rl2_PixelSource const source, unsigned const x0, unsigned const y0,
+    unsigned const width, unsigned const height, unsigned const columns, unsigned const rows, bool const trim) {
+
+    size_t const count = (size_t)columns * rows;
+
+    if (count == 0) {
+        return true;
+    }
+
+    rl2_ImageRect* const rects = (rl2_ImageRect*)rl2_alloc(count * sizeof(*rects));
+
+    if (rects == NULL) {
+        RL2_ERROR(TAG "out of memory");
+        return false;
+    }
+
+    for (unsigned row = 0, i = 0; row < rows; row++) {
+        for (unsigned column = 0; column < columns; column++, i++) {
+            rects[i].x0 = x0 + column * width;
+            rects[i].y0 = y0 + row * height;
+            rects[i].width = width;
+            rects[i].height = height;
+        }
+    }
+
+    bool const ok = rl2_encodeImages(images, source, rects, count, true, trim);
+    rl2_free(rects);
+    return ok;
+}
+
+void rl2_destroyImage(rl2_Image const image) {
+    if (image->packed) {
+        RL2_ERROR(TAG "image %p was created with others, destroy them all with rl2_destroyImages", image);
+        return;
+    }
+
+    rl2_free(image);
+}
+
+void rl2_destroyImages(rl2_Image* const images, size_t const count) {
+    // The first image is at the start of the block holding all of them
+    if (count != 0) {
+        rl2_free(images[0]);
+    }
+}
+
+static bool rl2_isLittleEndian(void) {
+    uint16_t const one = 1;
+    return *(uint8_t const*)&one == 1;
+}
+
+static size_t rl2_rleRowWords(rl2_Rle const* const row, unsigned const width) {
+    rl2_Rle const* rle = row;
+
+    for (unsigned x = 0; x < width;) {
+        rl2_RleOp const op = rl2_rleOp(*rle);
+        unsigned const length = rl2_rleLength(*rle);
+
+        rle += 1 + (op != RL2_RLE_SKIP ? length : 0);
+        x += length;
+    }
+
+    return rle - row;
+}
+
+// Walks the RLE operations of a row making sure they cover exactly width pixels without going past end
+static bool rl2_rleRowValid(rl2_Rle const* const row, rl2_Rle const* const end, unsigned const width, size_t* const pixels_used) {
+    rl2_Rle const* rle = row;
+
+    for (unsigned x = 0; x < width;) {
+        if (rle >= end) {
+            return false;
+        }
+
+        rl2_RleOp const op = rl2_rleOp(*rle);
+        unsigned const length = rl2_rleLength(*rle);
+
+        if (op > RL2_RLE_BLIT || length > width - x) {
+            return false;
+        }
+
+        if (op != RL2_RLE_SKIP) {
+            if ((size_t)(end - rle - 1) < length) {
+                return false;
+            }
+
+            *pixels_used += length;
+            rle += length;
+        }
+
+        rle++;
+        x += length;
+    }
+
+    return true;
+}
+
+// Finds where the parts of a serialized image start, checking each part against what's left of size before adding it
+// so that corrupted counts can't overflow the offsets; returns false if they don't fit
+static bool rl2_serializedLayout(
+    size_t const size, size_t const offsets_offset, unsigned const height, size_t const num_words,
+    size_t const checkpoints_per_row, size_t* const words_offset, size_t* const checkpoints_offset) {
+
+    if (size < offsets_offset || (size - offsets_offset) / sizeof(uint32_t) < height) {
+        return false;
+    }
+
+    *words_offset = offsets_offset + (size_t)height * sizeof(uint32_t);
+
+    if (num_words > (size - *words_offset) / sizeof(rl2_Rle)) {
+        return false;
+    }
+
+    size_t const words_size = (num_words * sizeof(rl2_Rle) + 3) & ~(size_t)3;
+
+    if (words_size > size - *words_offset) {
+        return false;
+    }
+
+    *checkpoints_offset = *words_offset + words_size;
+    size_t const max_checkpoints = (size - *checkpoints_offset) / sizeof(rl2_Checkpoint);
+    return checkpoints_per_row == 0 || max_checkpoints / checkpoints_per_row >= height;
+}
+
+size_t rl2_serializeImage(rl2_Image const image, void* const buffer, size_t const size) {
+    if (!rl2_isLittleEndian()) {
+        RL2_ERROR(TAG "serialized images are only supported on little-endian platforms");
+        return 0;
+    }
+
+    unsigned const width = image->width;
+    unsigned const height = image->height;
+    size_t num_words = 0;
+
+    for (unsigned y = 0; y < height; y++) {
+        num_words += rl2_rleRowWords(image->rows[y], width);
+    }
+
+    if (num_words > UINT32_MAX || image->pixels_used > UINT32_MAX) {
+        RL2_ERROR(TAG "image too big to serialize, %zu words and %zu pixels", num_words, image->pixels_used);
+        return 0;
+    }
+
+    bool const trimmed = image->width != image->full_width || image->height != image->full_height;
+    size_t const offsets_offset = sizeof(rl2_ImageHeader) + (trimmed ? sizeof(rl2_ImageTrim) : 0);
+
+    size_t const num_checkpoints = image->checkpoints != NULL ? (size_t)rl2_checkpointsPerRow(width) * height : 0;
+    size_t const words_offset = offsets_offset + height * sizeof(uint32_t);
+    size_t const checkpoints_offset = words_offset + ((num_words * sizeof(rl2_Rle) + 3) & ~(size_t)3);
+    size_t const required = checkpoints_offset + num_checkpoints * sizeof(rl2_Checkpoint);
+
+    if (buffer == NULL) {
+        return required;
+    }
+
+    if (size < required) {
+        RL2_ERROR(TAG "buffer too small to serialize image, %zu bytes needed but only %zu available", required, size);
+        return 0;
+    }
+
+    memset(buffer, 0, required);
+
+    rl2_ImageHeader* const header = (rl2_ImageHeader*)buffer;
+    memcpy(header->magic, RL2_IMAGE_MAGIC, sizeof(header->magic));
+    header->version = RL2_IMAGE_VERSION;
+    header->flags = (num_checkpoints != 0 ? RL2_IMAGE_HAS_CHECKPOINTS : 0) | (trimmed ? RL2_IMAGE_TRIMMED : 0) |
+                    RL2_IMAGE_PIXEL_FORMAT;
+    header->width = width;
+    header->height = height;
+    header->pixels_used = (uint32_t)image->pixels_used;
+    header->num_words = (uint32_t)num_words;
+
+    if (trimmed) {
+        rl2_ImageTrim* const trim = (rl2_ImageTrim*)(header + 1);
+        trim->left = image->left;
+        trim->top = image->top;
+        trim->full_width = image->full_width;
+        trim->full_height = image->full_height;
+    }
+
+    uint32_t* const offsets = (uint32_t*)((uint8_t*)buffer + offsets_offset);
+    rl2_Rle* const words = (rl2_Rle*)((uint8_t*)buffer + words_offset);
+    size_t offset = 0;
+
+    for (unsigned y = 0; y < height; y++) {
+        size_t const row_words = rl2_rleRowWords(image->rows[y], width);
+        memcpy(words + offset, image->rows[y], row_words * sizeof(rl2_Rle));
+
+        offsets[y] = (uint32_t)offset;
+        offset += row_words;
+    }
+
+    if (num_checkpoints != 0) {
+        memcpy((uint8_t*)buffer + checkpoints_offset, image->checkpoints, num_checkpoints * sizeof(rl2_Checkpoint));
+    }
+
+    return required;
+}
+
+static rl2_Image rl2_mapImage(void const* const data, size_t const size, char const* const path) {
+    if (!rl2_isLittleEndian()) {
+        RL2_ERROR(TAG "serialized images are only supported on little-endian platforms");
+        return NULL;
+    }
+
+    if (((uintptr_t)data & 3) != 0) {
+        RL2_ERROR(TAG "serialized image data at %p must be aligned to 4 bytes", data);
+        return NULL;
+    }
+
+    rl2_ImageHeader const* const header = (rl2_ImageHeader const*)data;
+
+    if (size < sizeof(*header) || memcmp(header->magic, RL2_IMAGE_MAGIC, sizeof(header->magic)) != 0) {
+        RL2_ERROR(TAG "invalid serialized image");
+        return NULL;
+    }
+
+    if (header->version != RL2_IMAGE_VERSION) {
+        RL2_ERROR(TAG "unsupported serialized image version %u", header->version);
+        return NULL;
+    }
+
+    if ((header->flags & RL2_IMAGE_XRGB8888) != RL2_IMAGE_PIXEL_FORMAT) {
+        RL2_ERROR(TAG "serialized image has pixels in a different format than the canvas");
+        return NULL;
+    }
+
+    unsigned const width = header->width;
+    unsigned const height = header->height;
+    size_t const num_words = header->num_words;
+
+    if (width == 0 || height == 0) {
+        RL2_ERROR(TAG "empty serialized image");
+        return NULL;
+    }
+
+    size_t const checkpoints_per_row =
+        (header->flags & RL2_IMAGE_HAS_CHECKPOINTS) != 0 ? rl2_checkpointsPerRow(width) : 0;
+
+    rl2_ImageTrim const* const trim =
+        (header->flags & RL2_IMAGE_TRIMMED) != 0 ? (rl2_ImageTrim const*)(header + 1) : NULL;
+
+    size_t const offsets_offset = sizeof(rl2_ImageHeader) + (trim != NULL ? sizeof(rl2_ImageTrim) : 0);
+    size_t words_offset, checkpoints_offset;
+
+    if (!rl2_serializedLayout(
+            size, offsets_offset, height, num_words, checkpoints_per_row, &words_offset, &checkpoints_offset)) {
+
+        RL2_ERROR(TAG "truncated serialized image");
+        return NULL;
+    }
+
+    // Can't overflow, rl2_serializedLayout checked that they fit in size
+    size_t const num_checkpoints = checkpoints_per_row * height;
+
+    if (trim != NULL && ((uint64_t)trim->left + width > trim->full_width ||
+                         (uint64_t)trim->top + height > trim->full_height)) {
+
+        RL2_ERROR(TAG "corrupted trimmed serialized image");
+        return NULL;
+    }
+
+#ifdef RL2_BUILD_DEBUG
+    size_t const path_size = path != NULL ? strlen(path) + 1 : 0;
+#else
+    size_t const path_size = 0;
+    (void)path;
+#endif
+
+    size_t const rows_size = sizeof(struct rl2_Image) + sizeof(rl2_Rle const*) * (height - 1);
+    rl2_Image const image = (rl2_Image)rl2_alloc(rows_size + path_size);
+
+    if (image == NULL) {
+        RL2_ERROR(TAG "out of memory");
+        return NULL;
+    }
+
+    image->width = width;
+    image->height = height;
+    image->left = trim != NULL ? trim->left : 0;
+    image->top = trim != NULL ? trim->top : 0;
+    image->full_width = trim != NULL ? trim->full_width : width;
+    image->full_height = trim != NULL ? trim->full_height : height;
+    image->pixels_used = 0;
+    image->packed = false;
+
+    // Point straight into the serialized data, only the row pointers are built here
+    uint32_t const* const offsets = (uint32_t const*)((uint8_t const*)data + offsets_offset);
+    rl2_Rle const* const words = (rl2_Rle const*)((uint8_t const*)data + words_offset);
+    rl2_Rle const* const end = words + num_words;
+
+    for (unsigned y = 0; y < height; y++) {
+        image->rows[y] = words + offsets[y];
+
+        // Rows must follow each other like rl2_serializeImage writes them, rl2_blitBand depends on it
+        bool const in_order = y == 0 ? offsets[y] == 0 :
+            image->rows[y] == image->rows[y - 1] + rl2_rleRowWords(image->rows[y - 1], width);
+
+        if (!in_order || offsets[y] >= num_words ||
+            !rl2_rleRowValid(image->rows[y], end, width, &image->pixels_used)) {
+            RL2_ERROR(TAG "corrupted row %u in serialized image", y);
+            rl2_free(image);
+            return NULL;
+        }
+    }
+
+    if (image->pixels_used != header->pixels_used) {
+        RL2_ERROR(TAG "corrupted serialized image");
+        rl2_free(image);
+        return NULL;
+    }
+
+    image->checkpoints =
+        num_checkpoints != 0 ? (rl2_Checkpoint const*)((uint8_t const*)data + checkpoints_offset) : NULL;
+
+    if (image->checkpoints != NULL) {
+        unsigned const per_row = rl2_checkpointsPerRow(width);
+
+        for (unsigned y = 0; y < height; y++) {
+            if (!rl2_checkpointsValid(image->checkpoints + (size_t)y * per_row, image->rows[y], width)) {
+                RL2_ERROR(TAG "corrupted checkpoints in row %u of serialized image", y);
+                rl2_free(image);
+                return NULL;
+            }
+        }
+    }
+
+    image->kind = rl2_classifyImage(image);
+    rl2_findOpaqueRect(image);
+
+#ifdef RL2_BUILD_DEBUG
+    if (path != NULL) {
+        char* const path_dup = (char*)image + rows_size;
+        memcpy(path_dup, path, path_size);
+        image->path = path_dup;
+    }
+    else {
+        image->path = NULL;
+    }
+#endif
+
+    return image;
+}
+
+rl2_Image rl2_initImage(void const* const data, size_t const size) {
+    return rl2_mapImage(data, size, NULL);
+}
+
+rl2_Image rl2_readImage(char const* const path, unsigned const max_height) {
+    RL2_DEBUG(TAG "reading image from \"%s\" with maximum height %u", path, max_height);
+
+    size_t size = 0;
+    void const* const data = rl2_mapFile(path, max_height, &size);
+
+    if (data == NULL) {
+        // Error already logged
+        return NULL;
+    }
+
+    return rl2_mapImage(data, size, path);
+}
+
+unsigned rl2_imageWidth(rl2_Image const image) {
+    return image->full_width;
+}
+
+unsigned rl2_imageHeight(rl2_Image const image) {
+    return image->full_height;
+}
+
+rl2_ImageRect rl2_imageBounds(rl2_Image const image) {
+    rl2_ImageRect bounds;
+    bounds.x0 = image->left;
+    bounds.y0 = image->top;
+    bounds.width = image->width;
+    bounds.height = image->height;
+    return bounds;
+}
+
+size_t rl2_changedPixels(rl2_Image const image) {
+    return image->pixels_used;
+}
+
+bool rl2_isImageOpaque(rl2_Image const image) {
+    // Trimmed borders are transparent
+    return image->kind == RL2_IMAGE_OPAQUE && image->width == image->full_width && image->height == image->full_height;
+}
+
+rl2_ImageRect rl2_flipRect(rl2_Image const image, rl2_ImageRect rect, unsigned const flip) {
+    if ((flip & RL2_FLIP_X) != 0) {
+        rect.x0 = image->full_width - rect.x0 - rect.width;
+    }
+
+    if ((flip & RL2_FLIP_Y) != 0) {
+        rect.y0 = image->full_height - rect.y0 - rect.height;
+    }
+
+    return rect;
+}
+
+rl2_ImageRect rl2_opaqueRect(rl2_Image const image) {
+    rl2_ImageRect rect = image->opaque;
+    rect.x0 += image->left;
+    rect.y0 += image->top;
+    return rect;
+}
+
+// Clips the encoded pixels to the canvas area with columns in [left, right) and rows in [top, bottom), x0 and y0
+// already have the trim offset added
+static bool rl2_clip(
+    rl2_Image const image, unsigned const left, unsigned const top, unsigned const right, unsigned const bottom,
+    int* const x0, int* const y0, unsigned* const width, unsigned* const height) {
+
+    unsigned const image_width = image->width;
+    unsigned const image_height = image->height;
+
+    if (left >= right || top >= bottom) {
+        return false;
+    }
+
+    if (*x0 < (int64_t)left) {
+        if ((int64_t)left - *x0 >= image_width) {
+            return false;
+        }
+    }
+    else if ((unsigned)(*x0) >= right) {
+        return false;
+    }
+
+    if (*y0 < (int64_t)top) {
+        if ((int64_t)top - *y0 >= image_height) {
+            return false;
+        }
+    }
+    else if ((unsigned)(*y0) >= bottom) {
+        return false;
+    }
+
+    *width = image_width;
+    *height = image_height;
+
+    if (*x0 < (int64_t)left) {
+        // Left clip, decrease total width and start at x0 = left
+        *width -= left - *x0;
+        *x0 = left;
+    }
+
+    if (*x0 + *width > right) {
+        // Right clip, decrease total width
+        *width = right - *x0;
+    }
+
+    if (*y0 < (int64_t)top) {
+        // Top clip, decrease total height and start at y0 = top
+        *height -= top - *y0;
+        *y0 = top;
+    }
+
+    if (*y0 + *height > bottom) {
+        // Bottom clip, decrease total height
+        *height = bottom - *y0;
+    }
+
+    return true;
+}
+
+// Unclipped rows don't need the cursor, the RLE operations are walked until the right edge of the image; compose
+// is a constant in all calls so that the compiler can drop the RL2_RLE_COMPOSE case for RL2_IMAGE_NO_COMPOSE images
+static inline rl2_Pixel* rl2_blitRow(
+    rl2_Pixel* pixel, rl2_Rle const* rle, unsigned const width, rl2_Pixel* bg, bool const compose) {
+
+    for (rl2_Pixel const* const end = pixel + width; pixel < end;) {
+        rl2_RleOp const op = rl2_rleOp(*rle);
+        unsigned const length = rl2_rleLength(*rle);
+        uint8_t const inv_alpha = rl2_rleInvAlpha(*rle);
+        rle++;
+
+        if (op != RL2_RLE_SKIP) {
+            memcpy(bg, pixel, length * sizeof(*bg));
+            bg += length;
+
+            if (compose && op == RL2_RLE_COMPOSE) {
+                rl2_composeSpan(pixel, rle, length, inv_alpha);
+            }
+            else {
+                memcpy(pixel, rle, length * sizeof(*pixel));
+            }
+
+            rle += length;
+        }
+
+        pixel += length;
+    }
+
+    return bg;
+}
+
+static rl2_Pixel const* rl2_unblitRow(
+    rl2_Pixel* pixel, rl2_Rle const* rle, unsigned const width, rl2_Pixel const* bg) {
+
+    for (rl2_Pixel const* const end = pixel + width; pixel < end;) {
+        rl2_RleOp const op = rl2_rleOp(*rle);
+        unsigned const length = rl2_rleLength(*rle);
+        rle++;
+
+        if (op != RL2_RLE_SKIP) {
+            memcpy(pixel, bg, length * sizeof(*bg));
+            bg += length;
+            rle += length;
+        }
+
+        pixel += length;
+    }
+
+    return bg;
+}
+
+static inline void rl2_stampRow(rl2_Pixel* pixel, rl2_Rle const* rle, unsigned const width, bool const compose) {
+    for (rl2_Pixel const* const end = pixel + width; pixel < end;) {
+        rl2_RleOp const op = rl2_rleOp(*rle);
+        unsigned const length = rl2_rleLength(*rle);
+        uint8_t const inv_alpha = rl2_rleInvAlpha(*rle);
+        rle++;
+
+        if (op != RL2_RLE_SKIP) {
+            if (compose && op == RL2_RLE_COMPOSE) {
+                rl2_composeSpan(pixel, rle, length, inv_alpha);
+            }
+            else {
+                memcpy(pixel, rle, length * sizeof(*pixel));
+            }
+
+            rle += length;
+        }
+
+        pixel += length;
+    }
+}
+
+// Pixels saved from each row go one after the other in bg, or when aligned at the same offset as the row's RLE
+// words, which is always enough since each saved pixel has its color in the row, so that any set of rows can be
+// unblit on their own
+static size_t rl2_rowOffset(rl2_Image const image, unsigned const row) {
+    return image->rows[row] - image->rows[0];
+}
+
+static rl2_Pixel* rl2_blitRows(
+    rl2_Image const image, rl2_Canvas const canvas, int const x0, int const y0, rl2_Pixel* const base,
+    unsigned const top, unsigned const bottom, bool const aligned) {
+
+    int new_x0 = x0, new_y0 = y0;
+    unsigned width, height;
+    rl2_Pixel* bg = base;
+    
+    // Clip the image to the canvas
+    if (!rl2_clip(image, 0, top, rl2_canvasWidth(canvas), bottom, &new_x0, &new_y0, &width, &height)) {
+        // Image is not visible
+        return bg;
+    }
+
+    // Evaluate the pixel on the canvas to blit to
+    rl2_Pixel* pixel = rl2_canvasPixel(canvas, new_x0, new_y0);
+    unsigned const first_row = new_y0 - y0;
+
+    if (image->kind == RL2_IMAGE_OPAQUE) {
+        // Save and overwrite whole spans of the canvas
+        unsigned const skip = new_x0 - x0;
+
+        for (unsigned y = 0; y < height; y++) {
+            bg = aligned ? base + rl2_rowOffset(image, first_row + y) : bg;
+
+            memcpy(bg, pixel, width * sizeof(*bg));
+            memcpy(pixel, image->rows[first_row + y] + 1 + skip, width * sizeof(*pixel));
+
+            bg += width;
+            pixel = rl2_canvasNextRow(canvas, pixel);
+        }
+
+        return bg;
+    }
+
+    if (width == image->width) {
+        // Not clipped horizontally, rows can be blit in full
+        bool const compose = image->kind == RL2_IMAGE_SPARSE;
+
+        for (unsigned y = 0; y < height; y++) {
+            bg = aligned ? base + rl2_rowOffset(image, first_row + y) : bg;
+
+            if (compose) {
+                bg = rl2_blitRow(pixel, image->rows[first_row + y], width, bg, true);
+            }
+            else {
+                bg = rl2_blitRow(pixel, image->rows[first_row + y], width, bg, false);
+            }
+
+            pixel = rl2_canvasNextRow(canvas, pixel);
+        }
+
+        return bg;
+    }
+
+    for (unsigned y = 0; y < height; y++) {
+        rl2_Pixel* const saved_pixel = pixel;
+        bg = aligned ? base + rl2_rowOffset(image, first_row + y) : bg;
+
+        // Position at the first visible pixel
+        rl2_RleCursor cursor;
+        rl2_rleSeek(&cursor, image, first_row + y, new_x0 - x0);
+
+        // Write the remaining pixels
+        for (unsigned remaining = width;;) {
+            unsigned const count = cursor.length <= remaining ? cursor.length : remaining;
+
+            if (cursor.op == RL2_RLE_BLIT) {
+                // Save the overwritten pixels
+                memcpy(bg, pixel, count * sizeof(*bg));
+                bg += count;
+
+                // Blit the image pixels
+                memcpy(pixel, cursor.rle, count * sizeof(*pixel));
+                cursor.rle += count;
+            }
+            else if (cursor.op == RL2_RLE_COMPOSE) {
+                // Save the overwritten pixels
+                memcpy(bg, pixel, count * sizeof(*bg));
+                bg += count;
+
+                // Compose the image pixels
+                rl2_composeSpan(pixel, cursor.rle, count, cursor.inv_alpha);
+                cursor.rle += count;
+            }
+
+            remaining -= count;
+            pixel += count;
+
+            if (remaining == 0) {
+                // Stop at the right edge without looking at the rest of the row
+                break;
+            }
+
+            // End of this RLE operation, fetch the next one
+            rl2_rleFetch(&cursor);
+        }
+
+        pixel = rl2_canvasNextRow(canvas, saved_pixel);
+    }
+
+    return bg;
+}
+
+static void rl2_unblitRows(
+    rl2_Image const image, rl2_Canvas const canvas, int const x0, int const y0, rl2_Pixel const* const base,
+    unsigned const top, unsigned const bottom, bool const aligned) {
+
+    int new_x0 = x0, new_y0 = y0;
+    unsigned width, height;
+    rl2_Pixel const* bg = base;
+    
+    // Clip the image to the canvas
+    if (!rl2_clip(image, 0, top, rl2_canvasWidth(canvas), bottom, &new_x0, &new_y0, &width, &height)) {
+        // Image is not visible
+        return;
+    }
+
+    // Evaluate the pixel on the canvas to blit to
+    rl2_Pixel* pixel = rl2_canvasPixel(canvas, new_x0, new_y0);
+    unsigned const first_row = new_y0 - y0;
+
+    if (image->kind == RL2_IMAGE_OPAQUE) {
+        for (unsigned y = 0; y < height; y++) {
+            bg = aligned ? base + rl2_rowOffset(image, first_row + y) : bg;
+            memcpy(pixel, bg, width * sizeof(*bg));
+
+            bg += width;
+            pixel = rl2_canvasNextRow(canvas, pixel);
+        }
+
+        return;
+    }
+
+    if (width == image->width) {
+        for (unsigned y = 0; y < height; y++) {
+            bg = aligned ? base + rl2_rowOffset(image, first_row + y) : bg;
+            bg = rl2_unblitRow(pixel, image->rows[first_row + y], width, bg);
+            pixel = rl2_canvasNextRow(canvas, pixel);
+        }
+
+        return;
+    }
+
+    for (unsigned y = 0; y < height; y++) {
+        rl2_Pixel* const saved_pixel = pixel;
+        bg = aligned ? base + rl2_rowOffset(image, first_row + y) : bg;
+
+        rl2_RleCursor cursor;
+        rl2_rleSeek(&cursor, image, first_row + y, new_x0 - x0);
+
+        // Restore the remaining pixels
+        for (unsigned remaining = width;;) {
+            unsigned const count = cursor.length <= remaining ? cursor.length : remaining;
+
+            if (cursor.op != RL2_RLE_SKIP) {
+                // Restore the overwritten pixels
+                memcpy(pixel, bg, count * sizeof(*bg));
+                bg += count;
+                cursor.rle += count;
+            }
+
+            remaining -= count;
+            pixel += count;
+
+            if (remaining == 0) {
+                break;
+            }
+
+            rl2_rleFetch(&cursor);
+        }
+
+        pixel = rl2_canvasNextRow(canvas, saved_pixel);
+    }
+}
+
+static void rl2_stampRows(
+    rl2_Image const image, rl2_Canvas const canvas, int const x0, int const y0, unsigned const left,
+    unsigned const top, unsigned const right, unsigned const bottom) {
+
+    // This is identical to rl2_blitRows, except overwritten pixels aren't saved
+    int new_x0 = x0, new_y0 = y0;
+    unsigned width, height;
+    
+    if (!rl2_clip(image, left, top, right, bottom, &new_x0, &new_y0, &width, &height)) {
+        return;
+    }
+
+    rl2_Pixel* pixel = rl2_canvasPixel(canvas, new_x0, new_y0);
+    unsigned const first_row = new_y0 - y0;
+
+    if (image->kind == RL2_IMAGE_OPAQUE) {
+        unsigned const skip = new_x0 - x0;
+
+        for (unsigned y = 0; y < height; y++) {
+            memcpy(pixel, image->rows[first_row + y] + 1 + skip, width * sizeof(*pixel));
+            pixel = rl2_canvasNextRow(canvas, pixel);
+        }
+
+        return;
+    }
+
+    if (width == image->width) {
+        bool const compose = image->kind == RL2_IMAGE_SPARSE;
+
+        for (unsigned y = 0; y < height; y++) {
+            if (compose) {
+                rl2_stampRow(pixel, image->rows[first_row + y], width, true);
+            }
+            else {
+                rl2_stampRow(pixel, image->rows[first_row + y], width, false);
+            }
+
+            pixel = rl2_canvasNextRow(canvas, pixel);
+        }
+
+        return;
+    }
+
+    for (unsigned y = 0; y < height; y++) {
+        rl2_Pixel* const saved_pixel = pixel;
+
+        rl2_RleCursor cursor;
+        rl2_rleSeek(&cursor, image, first_row + y, new_x0 - x0);
+
+        for (unsigned remaining = width;;) {
+            unsigned const count = cursor.length <= remaining ? cursor.length : remaining;
+
+            if (cursor.op == RL2_RLE_BLIT) {
+                memcpy(pixel, cursor.rle, count * sizeof(*pixel));
+                cursor.rle += count;
+            }
+            else if (cursor.op == RL2_RLE_COMPOSE) {
+                rl2_composeSpan(pixel, cursor.rle, count, cursor.inv_alpha);
+                cursor.rle += count;
+            }
+
+            remaining -= count;
+            pixel += count;
+
+            if (remaining == 0) {
+                break;
+            }
+
+            rl2_rleFetch(&cursor);
+        }
+
+        pixel = rl2_canvasNextRow(canvas, saved_pixel);
+    }
+}
+
+typedef enum {
+    RL2_DRAW_BLIT,
+    RL2_DRAW_UNBLIT,
+    RL2_DRAW_STAMP
+}
+rl2_DrawMode;
+
+// Mirrored runs go through a buffer this big on the stack
+#define RL2_FLIP_CHUNK 256
+
+// Draws count pixels of a run to the canvas span starting at pixel, which are in reverse order when mirrored; bg
+// always has the span in canvas order, so any flip unblits what the same flip blit
+static rl2_Pixel* rl2_drawRun(
+    rl2_Pixel* const pixel, rl2_Pixel const* const colors, unsigned const count, rl2_RleOp const op,
+    uint8_t const inv_alpha, rl2_Pixel* bg, rl2_DrawMode const mode, bool const mirror) {
+
+    if (mode == RL2_DRAW_UNBLIT) {
+        memcpy(pixel, bg, count * sizeof(*bg));
+        return bg + count;
+    }
+
+    if (mode == RL2_DRAW_BLIT) {
+        memcpy(bg, pixel, count * sizeof(*bg));
+        bg += count;
+    }
+
+    rl2_Pixel mirrored[RL2_FLIP_CHUNK];
+    rl2_Pixel const* src = colors;
+
+    if (mirror) {
+        for (unsigned i = 0; i < count; i++) {
+            mirrored[i] = colors[count - 1 - i];
+        }
+
+        src = mirrored;
+    }
+
+    if (op == RL2_RLE_COMPOSE) {
+        rl2_composeSpan(pixel, src, count, inv_alpha);
+    }
+    else {
+        memcpy(pixel, src, count * sizeof(*pixel));
+    }
+
+    return bg;
+}
+
+// Same as the functions above with the image mirrored; the RLE operations of each row are still walked left to right,
+// writing to the canvas from the right edge when flipped horizontally, and rows are walked bottom to top when flipped
+// vertically. Each image row saves the same pixels in bg as without flipping, at the same offset when aligned
+static rl2_Pixel* rl2_flippedRows(
+    rl2_Image const image, rl2_Canvas const canvas, int const x0, int const y0, rl2_Pixel* const base,
+    unsigned const left, unsigned const top, unsigned const right, unsigned const bottom, bool const aligned,
+    rl2_DrawMode const mode, unsigned const flip) {
+
+    int new_x0 = x0, new_y0 = y0;
+    unsigned width, height;
+    rl2_Pixel* bg = base;
+
+    if (!rl2_clip(image, left, top, right, bottom, &new_x0, &new_y0, &width, &height)) {
+        return bg;
+    }
+
+    bool const mirror = (flip & RL2_FLIP_X) != 0;
+    unsigned const left_clip = new_x0 - x0;
+    unsigned const skip = mirror ? image->width - left_clip - width : left_clip;
+    rl2_Pixel* pixel = rl2_canvasPixel(canvas, new_x0, new_y0);
+
+    for (unsigned y = 0; y < height; y++) {
+        unsigned const canvas_row = new_y0 - y0 + y;
+        unsigned const row = (flip & RL2_FLIP_Y) != 0 ? image->height - 1 - canvas_row : canvas_row;
+        bg = aligned ? base + rl2_rowOffset(image, row) : bg;
+
+        rl2_RleCursor cursor;
+        rl2_rleSeek(&cursor, image, row, skip);
+
+        for (unsigned done = 0;;) {
+            unsigned count = cursor.length <= width - done ? cursor.length : width - done;
+
+            if (cursor.op == RL2_RLE_SKIP) {
+                done += count;
+                count = 0;
+            }
+
+            while (count != 0) {
+                unsigned const chunk = mirror && count > RL2_FLIP_CHUNK ? RL2_FLIP_CHUNK : count;
+                rl2_Pixel* const span = mirror ? pixel + width - done - chunk : pixel + done;
+
+                bg = rl2_drawRun(span, cursor.rle, chunk, cursor.op, cursor.inv_alpha, bg, mode, mirror);
+
+                cursor.rle += chunk;
+                done += chunk;
+                count -= chunk;
+            }
+
+            if (done == width) {
+                break;
+            }
+
+            rl2_rleFetch(&cursor);
+        }
+
+        pixel = rl2_canvasNextRow(canvas, pixel);
+    }
+
+    return bg;
+}
+
+// Where the encoded pixels go on the canvas, trimmed borders move to the other side when flipped
+static int rl2_drawX(rl2_Image const image, int const x0, unsigned const flip) {
+    return x0 + (int)((flip & RL2_FLIP_X) != 0 ? image->full_width - image->left - image->width : image->left);
+}
+
+static int rl2_drawY(rl2_Image const image, int const y0, unsigned const flip) {
+    return y0 + (int)((flip & RL2_FLIP_Y) != 0 ? image->full_height - image->top - image->height : image->top);
+}
+
+static rl2_Pixel* rl2_blitImage(
+    rl2_Image const image, rl2_Canvas const canvas, int const x0, int const y0, unsigned const flip, rl2_Pixel* const bg,
+    unsigned const top, unsigned const bottom, bool const aligned) {
+
+    int const x = rl2_drawX(image, x0, flip), y = rl2_drawY(image, y0, flip);
+
+    if (flip == RL2_FLIP_NONE) {
+        return rl2_blitRows(image, canvas, x, y, bg, top, bottom, aligned);
+    }
+
+    return rl2_flippedRows(
+        image, canvas, x, y, bg, 0, top, rl2_canvasWidth(canvas), bottom, aligned, RL2_DRAW_BLIT, flip);
+}
+
+static void rl2_unblitImage(
+    rl2_Image const image, rl2_Canvas const canvas, int const x0, int const y0, unsigned const flip,
+    rl2_Pixel const* const bg, unsigned const top, unsigned const bottom, bool const aligned) {
+
+    int const x = rl2_drawX(image, x0, flip), y = rl2_drawY(image, y0, flip);
+
+    if (flip == RL2_FLIP_NONE) {
+        rl2_unblitRows(image, canvas, x, y, bg, top, bottom, aligned);
+    }
+    else {
+        // Only read in RL2_DRAW_UNBLIT mode
+        rl2_flippedRows(
+            image, canvas, x, y, (rl2_Pixel*)bg, 0, top, rl2_canvasWidth(canvas), bottom, aligned, RL2_DRAW_UNBLIT,
+            flip);
+    }
+}
+
+static void rl2_stampImage(
+    rl2_Image const image, rl2_Canvas const canvas, int const x0, int const y0, unsigned const flip,
+    unsigned const left, unsigned const top, unsigned const right, unsigned const bottom) {
+
+    int const x = rl2_drawX(image, x0, flip), y = rl2_drawY(image, y0, flip);
+
+    if (flip == RL2_FLIP_NONE) {
+        rl2_stampRows(image, canvas, x, y, left, top, right, bottom);
+    }
+    else {
+        rl2_flippedRows(image, canvas, x, y, NULL, left, top, right, bottom, false, RL2_DRAW_STAMP, flip);
+    }
+}
+
+// Reports the image area as damaged, band functions leave that to the caller so they don't race each other
+static void rl2_damageImage(rl2_Image const image, rl2_Canvas const canvas, int const x0, int const y0, unsigned const flip) {
+    rl2_damageCanvas(canvas, rl2_drawX(image, x0, flip), rl2_drawY(image, y0, flip), image->width, image->height);
+}
+
+rl2_Pixel* rl2_blit(rl2_Image const image, rl2_Canvas const canvas, int const x0, int const y0, rl2_Pixel* bg) {
+    return rl2_blitFlipped(image, canvas, x0, y0, RL2_FLIP_NONE, bg);
+}
+
+void rl2_unblit(rl2_Image const image, rl2_Canvas const canvas, int const x0, int const y0, rl2_Pixel const* bg) {
+    rl2_unblitFlipped(image, canvas, x0, y0, RL2_FLIP_NONE, bg);
+}
+
+void rl2_stamp(rl2_Image const image, rl2_Canvas const canvas, int const x0, int const y0) {
+    rl2_stampFlipped(image, canvas, x0, y0, RL2_FLIP_NONE);
+}
+
+rl2_Pixel* rl2_blitFlipped(
+    rl2_Image const image, rl2_Canvas const canvas, int const x0, int const y0, unsigned const flip, rl2_Pixel* bg) {
+
+    rl2_damageImage(image, canvas, x0, y0, flip);
+    return rl2_blitImage(image, canvas, x0, y0, flip, bg, 0, rl2_canvasHeight(canvas), false);
+}
+
+void rl2_unblitFlipped(
+    rl2_Image const image, rl2_Canvas const canvas, int const x0, int const y0, unsigned const flip,
+    rl2_Pixel const* bg) {
+
+    rl2_damageImage(image, canvas, x0, y0, flip);
+    rl2_unblitImage(image, canvas, x0, y0, flip, bg, 0, rl2_canvasHeight(canvas), false);
+}
+
+void rl2_stampFlipped(rl2_Image const image, rl2_Canvas const canvas, int const x0, int const y0, unsigned const flip) {
+    rl2_damageImage(image, canvas, x0, y0, flip);
+    rl2_stampImage(image, canvas, x0, y0, flip, 0, 0, rl2_canvasWidth(canvas), rl2_canvasHeight(canvas));
+}
+
+size_t rl2_bandBufferSize(rl2_Image const image) {
+    rl2_Rle const* const last = image->rows[image->height - 1];
+    return last + rl2_rleRowWords(last, image->width) - image->rows[0];
+}
+
+void rl2_blitBand(
+    rl2_Image const image, rl2_Canvas const canvas, int const x0, int const y0, unsigned const flip,
+    rl2_Pixel* const bg, unsigned const top, unsigned const bottom) {
+
+    rl2_blitImage(image, canvas, x0, y0, flip, bg, top, bottom, true);
+}
+
+void rl2_unblitBand(
+    rl2_Image const image, rl2_Canvas const canvas, int const x0, int const y0, unsigned const flip,
+    rl2_Pixel const* const bg, unsigned const top, unsigned const bottom) {
+
+    rl2_unblitImage(image, canvas, x0, y0, flip, bg, top, bottom, true);
+}
+
+void rl2_stampBand(
+    rl2_Image const image, rl2_Canvas const canvas, int const x0, int const y0, unsigned const flip,
+    unsigned const top, unsigned const bottom) {
+
+    rl2_stampImage(image, canvas, x0, y0, flip, 0, top, rl2_canvasWidth(canvas), bottom);
+}
+
+void rl2_stampArea(
+    rl2_Image const image, rl2_Canvas const canvas, int const x0, int const y0, unsigned const flip,
+    rl2_DamageRect const* const area) {
+
+    rl2_stampImage(image, canvas, x0, y0, flip, area->x0, area->y0, area->x0 + area->width, area->y0 + area->height);
+}
 #ifdef RL2_BUILD_DEBUG
 char const* rl2_getImagePath(rl2_Image const image) {
     return image->path;
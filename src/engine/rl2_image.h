@@ -6,18 +6,109 @@
 
 typedef struct rl2_Image* rl2_Image;
 
+// Images can be drawn mirrored, or rotated 180 degrees with both flags
+typedef enum {
+    RL2_FLIP_NONE = 0,
+    RL2_FLIP_X = 1,
+    RL2_FLIP_Y = 2
+}
+rl2_ImageFlip;
+
+typedef struct {
+    unsigned x0;
+    unsigned y0;
+    unsigned width;
+    unsigned height;
+}
+rl2_ImageRect;
+
 rl2_Image rl2_createImage(rl2_PixelSource const source);
+
+// Only encodes the pixels inside the bounding box of the ones that aren't fully transparent. The image keeps its size
+// and is drawn at the same place, but rows and columns around the box are never touched, see rl2_imageBounds
+rl2_Image rl2_createTrimmedImage(rl2_PixelSource const source);
+
 void rl2_destroyImage(rl2_Image const image);
 
+// Creates count images from rectangles in source, encoding rows on the workers and packing all images in a single
+// allocation; they can only be destroyed together with rl2_destroyImages. Each one is trimmed like
+// rl2_createTrimmedImage if trim is true
+bool rl2_createImages(
+    rl2_Image* const images, rl2_PixelSource const source, rl2_ImageRect const* const rects, size_t const count,
+    bool const trim);
+
+// Same as above, for a grid of columns * rows cells of the same size, in row-major order
+bool rl2_createImageGrid(
+    rl2_Image* const images, rl2_PixelSource const source, unsigned const x0, unsigned const y0,
+    unsigned const width, unsigned const height, unsigned const columns, unsigned const rows, bool const trim);
+
+void rl2_destroyImages(rl2_Image* const images, size_t const count);
+
+// Writes the image to buffer in a format that can be used in place by rl2_initImage and rl2_readImage, returns the
+// number of bytes needed when buffer is NULL, and 0 on errors
+size_t rl2_serializeImage(rl2_Image const image, void* const buffer, size_t const size);
+
+// The image references data, which must be 4-byte aligned and outlive it, nothing is decoded or copied
+rl2_Image rl2_initImage(void const* const data, size_t const size);
+rl2_Image rl2_readImage(char const* const path, unsigned const max_height);
+
 unsigned rl2_imageWidth(rl2_Image const image);
 unsigned rl2_imageHeight(rl2_Image const image);
+
+// Rectangle inside the image that drawing it can change, all of it unless it was trimmed
+rl2_ImageRect rl2_imageBounds(rl2_Image const image);
+
+// Where rect inside the image ends up when it's drawn with the flip flags
+rl2_ImageRect rl2_flipRect(rl2_Image const image, rl2_ImageRect rect, unsigned const flip);
+
 size_t rl2_changedPixels(rl2_Image const image);
 
-rl2_RGB565* rl2_blit(rl2_Image const image, rl2_Canvas const canvas, int const x0, int const y0, rl2_RGB565* bg);
-void rl2_unblit(rl2_Image const image, rl2_Canvas const canvas, int const x0, int const y0, rl2_RGB565 const* const bg);
+// True when all pixels are opaque, so drawing the image is copying its rows
+bool rl2_isImageOpaque(rl2_Image const image);
+
+// Largest rectangle of opaque pixels in the image, found when it's created; width and height are 0 if there are no
+// opaque pixels. Whatever is drawn under it before the image is hidden
+rl2_ImageRect rl2_opaqueRect(rl2_Image const image);
+
+rl2_Pixel* rl2_blit(rl2_Image const image, rl2_Canvas const canvas, int const x0, int const y0, rl2_Pixel* bg);
+void rl2_unblit(rl2_Image const image, rl2_Canvas const canvas, int const x0, int const y0, rl2_Pixel const* const bg);
 
 void rl2_stamp(rl2_Image const image, rl2_Canvas const canvas, int const x0, int const y0);
 
+// Flipped versions mirror the image inside its rectangle with rl2_ImageFlip flags while decoding its rows, saving as
+// many pixels in bg as unflipped; an image must be unblit with the same flags it was blit with
+rl2_Pixel* rl2_blitFlipped(
+    rl2_Image const image, rl2_Canvas const canvas, int const x0, int const y0, unsigned const flip, rl2_Pixel* bg);
+
+void rl2_unblitFlipped(
+    rl2_Image const image, rl2_Canvas const canvas, int const x0, int const y0, unsigned const flip,
+    rl2_Pixel const* bg);
+
+void rl2_stampFlipped(rl2_Image const image, rl2_Canvas const canvas, int const x0, int const y0, unsigned const flip);
+
+// Band versions only touch the canvas rows in [top, bottom), so different bands can be drawn in parallel. Pixels saved
+// from each image row always go to the same place in bg, which must have room for rl2_bandBufferSize pixels, so an
+// image blit in any bands can be unblit in any other bands. They take the same flip flags as the flipped versions and
+// don't report damage, see rl2_damageCanvas
+size_t rl2_bandBufferSize(rl2_Image const image);
+
+void rl2_blitBand(
+    rl2_Image const image, rl2_Canvas const canvas, int const x0, int const y0, unsigned const flip,
+    rl2_Pixel* const bg, unsigned const top, unsigned const bottom);
+
+void rl2_unblitBand(
+    rl2_Image const image, rl2_Canvas const canvas, int const x0, int const y0, unsigned const flip,
+    rl2_Pixel const* const bg, unsigned const top, unsigned const bottom);
+
+void rl2_stampBand(
+    rl2_Image const image, rl2_Canvas const canvas, int const x0, int const y0, unsigned const flip,
+    unsigned const top, unsigned const bottom);
+
+// Same as rl2_stampBand, but only touches the pixels inside area, which must be inside the canvas
+void rl2_stampArea(
+    rl2_Image const image, rl2_Canvas const canvas, int const x0, int const y0, unsigned const flip,
+    rl2_DamageRect const* const area);
+
 #ifdef RL2_BUILD_DEBUG
 char const* rl2_getImagePath(rl2_Image const image);
 #endif
@@ -0,0 +1,442 @@
+#include "rl2_indexed.h"
+#include "rl2_heap.h"
+#include "rl2_jobs.h"
+#include "rl2_log.h"
+
+#include <string.h>
+
+#define TAG "IDX "
+
+// Rows expanded by each job
+#define RL2_EXPAND_BATCH 16
+
+typedef enum {
+    // RLE is 14 bits for length - 1 || 2 bits for operation, in two bytes, little-endian
+    RL2_INDEXED_SKIP = 0,
+
+    // Same RLE followed by length indices copied to the canvas
+    RL2_INDEXED_BLIT,
+
+    // Same RLE followed by length indices translated by the remap table
+    RL2_INDEXED_REMAP
+}
+rl2_IndexedOp;
+
+#define RL2_INDEXED_MAX_RUN 16384
+
+typedef enum {
+    RL2_DRAW_BLIT,
+    RL2_DRAW_UNBLIT,
+    RL2_DRAW_STAMP
+}
+rl2_DrawMode;
+
+struct rl2_Palette {
+    rl2_Pixel colors[256];
+    uint8_t rgb[256][3];
+    bool remappable[256];
+};
+
+struct rl2_IndexedCanvas {
+    unsigned width;
+    unsigned height;
+    size_t pitch;
+    uint8_t* pixels;
+};
+
+struct rl2_IndexedImage {
+    unsigned width;
+    unsigned height;
+    size_t pixels_used;
+    uint8_t const* rows[1];
+};
+
+typedef struct {
+    uint8_t const* rle;
+    rl2_IndexedOp op;
+    unsigned length;
+}
+rl2_IndexedCursor;
+
+rl2_Palette rl2_createPalette(void) {
+    rl2_Palette const palette = (rl2_Palette)rl2_alloc(sizeof(*palette));
+
+    if (palette == NULL) {
+        RL2_ERROR(TAG "out of memory creating palette");
+        return NULL;
+    }
+
+    for (unsigned i = 0; i < 256; i++) {
+        palette->colors[i] = RL2_COLOR(0, 0, 0);
+    }
+
+    memset(palette->rgb, 0, sizeof(palette->rgb));
+    memset(palette->remappable, 0, sizeof(palette->remappable));
+    return palette;
+}
+
+void rl2_destroyPalette(rl2_Palette const palette) {
+    rl2_free(palette);
+}
+
+void rl2_setPaletteColor(rl2_Palette const palette, uint8_t const index, uint8_t const r, uint8_t const g, uint8_t const b) {
+    palette->colors[index] = RL2_COLOR(r, g, b);
+    palette->rgb[index][0] = r;
+    palette->rgb[index][1] = g;
+    palette->rgb[index][2] = b;
+}
+
+rl2_Pixel rl2_paletteColor(rl2_Palette const palette, uint8_t const index) {
+    return palette->colors[index];
+}
+
+void rl2_setPaletteRemappable(rl2_Palette const palette, uint8_t const first, unsigned const count, bool const remappable) {
+    // count can be anything, compare it with what's left so that first + count can't wrap
+    unsigned const last = count < 256u - first ? first + count : 256u;
+
+    for (unsigned i = first; i < last; i++) {
+        palette->remappable[i] = remappable;
+    }
+}
+
+rl2_IndexedCanvas rl2_createIndexedCanvas(unsigned const width, unsigned const height) {
+    size_t const pitch = (width + 15) & ~15;
+    rl2_IndexedCanvas const canvas = (rl2_IndexedCanvas)rl2_alloc(sizeof(*canvas) + pitch * height);
+
+    if (canvas == NULL) {
+        RL2_ERROR(TAG "out of memory creating indexed canvas");
+        return NULL;
+    }
+
+    canvas->width = width;
+    canvas->height = height;
+    canvas->pitch = pitch;
+    canvas->pixels = (uint8_t*)(canvas + 1);
+
+    RL2_INFO(TAG "indexed canvas created @%p, width=%u, height=%u, pitch=%zu", canvas, width, height, pitch);
+    return canvas;
+}
+
+void rl2_destroyIndexedCanvas(rl2_IndexedCanvas const canvas) {
+    rl2_free(canvas);
+}
+
+unsigned rl2_indexedCanvasWidth(rl2_IndexedCanvas const canvas) {
+    return canvas->width;
+}
+
+unsigned rl2_indexedCanvasHeight(rl2_IndexedCanvas const canvas) {
+    return canvas->height;
+}
+
+void rl2_clearIndexedCanvas(rl2_IndexedCanvas const canvas, uint8_t const index) {
+    memset(canvas->pixels, index, canvas->pitch * canvas->height);
+}
+
+uint8_t* rl2_indexedCanvasPixel(rl2_IndexedCanvas const canvas, unsigned const x, unsigned const y) {
+    return canvas->pixels + y * canvas->pitch + x;
+}
+
+typedef struct {
+    rl2_IndexedCanvas indexed;
+    rl2_Palette palette;
+    rl2_Canvas canvas;
+}
+rl2_Expansion;
+
+static void rl2_expandJob(void* const userdata, size_t const batch) {
+    rl2_Expansion const* const expansion = (rl2_Expansion const*)userdata;
+    rl2_IndexedCanvas const indexed = expansion->indexed;
+    rl2_Pixel const* const colors = expansion->palette->colors;
+
+    unsigned const y0 = batch * RL2_EXPAND_BATCH;
+    unsigned const y1 = indexed->height - y0 < RL2_EXPAND_BATCH ? indexed->height : y0 + RL2_EXPAND_BATCH;
+
+    for (unsigned y = y0; y < y1; y++) {
+        uint8_t const* const src = rl2_indexedCanvasPixel(indexed, 0, y);
+        rl2_Pixel* const dst = rl2_canvasPixel(expansion->canvas, 0, y);
+
+        for (unsigned x = 0; x < indexed->width; x++) {
+            dst[x] = colors[src[x]];
+        }
+    }
+}
+
+bool rl2_expandIndexedCanvas(rl2_IndexedCanvas const indexed, rl2_Palette const palette, rl2_Canvas const canvas) {
+    if (indexed->width != rl2_canvasWidth(canvas) || indexed->height != rl2_canvasHeight(canvas)) {
+        RL2_ERROR(
+            TAG "indexed canvas is %ux%u but the canvas is %ux%u", indexed->width, indexed->height,
+            rl2_canvasWidth(canvas), rl2_canvasHeight(canvas));
+
+        return false;
+    }
+
+    rl2_Expansion expansion;
+    expansion.indexed = indexed;
+    expansion.palette = palette;
+    expansion.canvas = canvas;
+
+    rl2_parallelFor(rl2_expandJob, &expansion, (indexed->height + RL2_EXPAND_BATCH - 1) / RL2_EXPAND_BATCH);
+    rl2_damageCanvas(canvas, 0, 0, indexed->width, indexed->height);
+    return true;
+}
+
+static uint8_t rl2_closestColor(rl2_Palette const palette, rl2_ARGB8888 const pixel) {
+    int const r = RL2_ARGB8888_R(pixel), g = RL2_ARGB8888_G(pixel), b = RL2_ARGB8888_B(pixel);
+    unsigned best = 0, best_distance = UINT32_MAX;
+
+    for (unsigned i = 0; i < 256 && best_distance != 0; i++) {
+        int const dr = r - palette->rgb[i][0], dg = g - palette->rgb[i][1], db = b - palette->rgb[i][2];
+        unsigned const distance = (unsigned)(dr * dr + dg * dg + db * db);
+
+        if (distance < best_distance) {
+            best = i;
+            best_distance = distance;
+        }
+    }
+
+    return (uint8_t)best;
+}
+
+static void rl2_indexedRle(uint8_t* const rle, rl2_IndexedOp const op, unsigned const length) {
+    unsigned const word = op | (length - 1) << 2;
+    rle[0] = word & 255;
+    rle[1] = word >> 8;
+}
+
+// Encodes a row of ops and indices, or just returns its size when rle is NULL
+static size_t rl2_encodeIndexedRow(
+    uint8_t* const rle, uint8_t const* const ops, uint8_t const* const indices, unsigned const width) {
+
+    size_t size = 0;
+
+    for (unsigned x = 0; x < width;) {
+        rl2_IndexedOp const op = (rl2_IndexedOp)ops[x];
+        unsigned length = 1;
+
+        while (x + length < width && ops[x + length] == op && length < RL2_INDEXED_MAX_RUN) {
+            length++;
+        }
+
+        if (rle != NULL) {
+            rl2_indexedRle(rle + size, op, length);
+
+            if (op != RL2_INDEXED_SKIP) {
+                memcpy(rle + size + 2, indices + x, length);
+            }
+        }
+
+        size += 2 + (op != RL2_INDEXED_SKIP ? length : 0);
+        x += length;
+    }
+
+    return size;
+}
+
+rl2_IndexedImage rl2_createIndexedImage(rl2_PixelSource const source, rl2_Palette const palette) {
+    unsigned const width = rl2_pixelSourceWidth(source);
+    unsigned const height = rl2_pixelSourceHeight(source);
+
+    if (width == 0 || height == 0) {
+        RL2_ERROR(TAG "empty pixel source");
+        return NULL;
+    }
+
+    // Operation and palette index of each pixel
+    uint8_t* const ops = (uint8_t*)rl2_alloc((size_t)width * height * 2);
+
+    if (ops == NULL) {
+        RL2_ERROR(TAG "out of memory");
+        return NULL;
+    }
+
+    uint8_t* const indices = ops + (size_t)width * height;
+    rl2_ARGB8888 last_pixel = 0; // never matches, opaque pixels get their alpha set below
+    uint8_t last_index = 0;
+    size_t pixels_used = 0;
+    size_t size = 0;
+
+    for (unsigned y = 0; y < height; y++) {
+        rl2_ARGB8888 const* const row = rl2_pixelSourceRow(source, y);
+        uint8_t* const row_ops = ops + (size_t)y * width;
+        uint8_t* const row_indices = indices + (size_t)y * width;
+
+        for (unsigned x = 0; x < width; x++) {
+            rl2_ARGB8888 const pixel = row[x] | UINT32_C(0xff000000);
+
+            if (RL2_ARGB8888_A(row[x]) < 128) {
+                row_ops[x] = RL2_INDEXED_SKIP;
+                continue;
+            }
+
+            if (pixel != last_pixel) {
+                // Neighbouring pixels tend to have the same color, don't search the palette for each one
+                last_pixel = pixel;
+                last_index = rl2_closestColor(palette, pixel);
+            }
+
+            row_indices[x] = last_index;
+            row_ops[x] = palette->remappable[last_index] ? RL2_INDEXED_REMAP : RL2_INDEXED_BLIT;
+            pixels_used++;
+        }
+
+        size += rl2_encodeIndexedRow(NULL, row_ops, row_indices, width);
+    }
+
+    size_t const rows_size = sizeof(struct rl2_IndexedImage) + sizeof(uint8_t const*) * (height - 1);
+    rl2_IndexedImage const image = (rl2_IndexedImage)rl2_alloc(rows_size + size);
+
+    if (image == NULL) {
+        RL2_ERROR(TAG "out of memory");
+        rl2_free(ops);
+        return NULL;
+    }
+
+    image->width = width;
+    image->height = height;
+    image->pixels_used = pixels_used;
+
+    uint8_t* rle = (uint8_t*)image + rows_size;
+
+    for (unsigned y = 0; y < height; y++) {
+        image->rows[y] = rle;
+        rle += rl2_encodeIndexedRow(rle, ops + (size_t)y * width, indices + (size_t)y * width, width);
+    }
+
+    rl2_free(ops);
+    return image;
+}
+
+void rl2_destroyIndexedImage(rl2_IndexedImage const image) {
+    rl2_free(image);
+}
+
+unsigned rl2_indexedImageWidth(rl2_IndexedImage const image) {
+    return image->width;
+}
+
+unsigned rl2_indexedImageHeight(rl2_IndexedImage const image) {
+    return image->height;
+}
+
+size_t rl2_indexedChangedPixels(rl2_IndexedImage const image) {
+    return image->pixels_used;
+}
+
+static void rl2_indexedFetch(rl2_IndexedCursor* const cursor) {
+    unsigned const word = cursor->rle[0] | (unsigned)cursor->rle[1] << 8;
+    cursor->rle += 2;
+    cursor->op = (rl2_IndexedOp)(word & 3);
+    cursor->length = (word >> 2) + 1;
+}
+
+static void rl2_indexedSeek(rl2_IndexedCursor* const cursor, uint8_t const* const row, unsigned skip) {
+    cursor->rle = row;
+    rl2_indexedFetch(cursor);
+
+    while (skip != 0) {
+        unsigned const count = cursor->length <= skip ? cursor->length : skip;
+
+        if (cursor->op != RL2_INDEXED_SKIP) {
+            cursor->rle += count;
+        }
+
+        cursor->length -= count;
+        skip -= count;
+
+        if (cursor->length == 0) {
+            rl2_indexedFetch(cursor);
+        }
+    }
+}
+
+static void rl2_remapSpan(uint8_t* const dst, uint8_t const* const src, size_t const count, uint8_t const* const remap) {
+    if (remap == NULL) {
+        memcpy(dst, src, count);
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        dst[i] = remap[src[i]];
+    }
+}
+
+// Blitting saves the covered pixels to bg and unblitting restores them from saved, which is only read
+static uint8_t* rl2_drawIndexed(
+    rl2_IndexedImage const image, rl2_IndexedCanvas const canvas, int const x0, int const y0,
+    uint8_t const* const remap, uint8_t* bg, uint8_t const* saved, rl2_DrawMode const mode) {
+
+    // Clip the image to the canvas
+    int64_t const left = x0 < 0 ? 0 : x0, top = y0 < 0 ? 0 : y0;
+    int64_t const right = (int64_t)x0 + image->width, bottom = (int64_t)y0 + image->height;
+    int64_t const clip_right = right < canvas->width ? right : canvas->width;
+    int64_t const clip_bottom = bottom < canvas->height ? bottom : canvas->height;
+
+    if (left >= clip_right || top >= clip_bottom) {
+        return bg;
+    }
+
+    unsigned const skip = (unsigned)(left - x0);
+    unsigned const width = (unsigned)(clip_right - left);
+
+    for (int64_t y = top; y < clip_bottom; y++) {
+        uint8_t* pixel = rl2_indexedCanvasPixel(canvas, (unsigned)left, (unsigned)y);
+
+        rl2_IndexedCursor cursor;
+        rl2_indexedSeek(&cursor, image->rows[y - y0], skip);
+
+        for (unsigned x = 0; x < width;) {
+            unsigned const count = cursor.length <= width - x ? cursor.length : width - x;
+
+            if (cursor.op != RL2_INDEXED_SKIP) {
+                switch (mode) {
+                    case RL2_DRAW_BLIT:
+                        memcpy(bg, pixel, count);
+                        bg += count;
+                        // fallthrough
+
+                    case RL2_DRAW_STAMP:
+                        rl2_remapSpan(pixel, cursor.rle, count, cursor.op == RL2_INDEXED_REMAP ? remap : NULL);
+                        break;
+
+                    case RL2_DRAW_UNBLIT:
+                        memcpy(pixel, saved, count);
+                        saved += count;
+                        break;
+                }
+
+                cursor.rle += count;
+            }
+
+            pixel += count;
+            x += count;
+            cursor.length -= count;
+
+            if (cursor.length == 0 && x < width) {
+                rl2_indexedFetch(&cursor);
+            }
+        }
+    }
+
+    return bg;
+}
+
+uint8_t* rl2_blitIndexed(
+    rl2_IndexedImage const image, rl2_IndexedCanvas const canvas, int const x0, int const y0,
+    uint8_t const* const remap, uint8_t* const bg) {
+
+    return rl2_drawIndexed(image, canvas, x0, y0, remap, bg, NULL, RL2_DRAW_BLIT);
+}
+
+void rl2_unblitIndexed(
+    rl2_IndexedImage const image, rl2_IndexedCanvas const canvas, int const x0, int const y0, uint8_t const* const bg) {
+
+    rl2_drawIndexed(image, canvas, x0, y0, NULL, NULL, bg, RL2_DRAW_UNBLIT);
+}
+
+void rl2_stampIndexed(
+    rl2_IndexedImage const image, rl2_IndexedCanvas const canvas, int const x0, int const y0,
+    uint8_t const* const remap) {
+
+    rl2_drawIndexed(image, canvas, x0, y0, remap, NULL, NULL, RL2_DRAW_STAMP);
+}
@@ -0,0 +1,61 @@
+#ifndef RL2_INDEXED_H__
+#define RL2_INDEXED_H__
+
+#include "rl2_canvas.h"
+#include "rl2_pixelsrc.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Palette-indexed drawing: indexed canvases and images have one byte per pixel, and the colors only come into play
+// when the canvas is expanded, so fades and flashes are palette writes instead of redraws
+typedef struct rl2_Palette* rl2_Palette;
+typedef struct rl2_IndexedCanvas* rl2_IndexedCanvas;
+typedef struct rl2_IndexedImage* rl2_IndexedImage;
+
+// All colors start black and not remappable
+rl2_Palette rl2_createPalette(void);
+void rl2_destroyPalette(rl2_Palette const palette);
+
+void rl2_setPaletteColor(rl2_Palette const palette, uint8_t const index, uint8_t const r, uint8_t const g, uint8_t const b);
+rl2_Pixel rl2_paletteColor(rl2_Palette const palette, uint8_t const index);
+
+// Pixels with remappable colors are encoded in remap runs, which the blitters translate with the table they're given;
+// i.e. mark the team colors as remappable and pass a table that swaps them with the colors of another team
+void rl2_setPaletteRemappable(rl2_Palette const palette, uint8_t const first, unsigned const count, bool const remappable);
+
+rl2_IndexedCanvas rl2_createIndexedCanvas(unsigned const width, unsigned const height);
+void rl2_destroyIndexedCanvas(rl2_IndexedCanvas const canvas);
+
+unsigned rl2_indexedCanvasWidth(rl2_IndexedCanvas const canvas);
+unsigned rl2_indexedCanvasHeight(rl2_IndexedCanvas const canvas);
+
+void rl2_clearIndexedCanvas(rl2_IndexedCanvas const canvas, uint8_t const index);
+uint8_t* rl2_indexedCanvasPixel(rl2_IndexedCanvas const canvas, unsigned const x, unsigned const y);
+
+// Writes the palette colors of all pixels to canvas, which must have the same size; rows are expanded on the workers
+bool rl2_expandIndexedCanvas(rl2_IndexedCanvas const indexed, rl2_Palette const palette, rl2_Canvas const canvas);
+
+// Pixels with alpha under 128 are transparent and the others get the closest color in the palette, which isn't
+// needed after the image is created
+rl2_IndexedImage rl2_createIndexedImage(rl2_PixelSource const source, rl2_Palette const palette);
+void rl2_destroyIndexedImage(rl2_IndexedImage const image);
+
+unsigned rl2_indexedImageWidth(rl2_IndexedImage const image);
+unsigned rl2_indexedImageHeight(rl2_IndexedImage const image);
+size_t rl2_indexedChangedPixels(rl2_IndexedImage const image);
+
+// remap translates the indices of the remappable pixels, NULL draws them as they are
+uint8_t* rl2_blitIndexed(
+    rl2_IndexedImage const image, rl2_IndexedCanvas const canvas, int const x0, int const y0,
+    uint8_t const* const remap, uint8_t* const bg);
+
+void rl2_unblitIndexed(
+    rl2_IndexedImage const image, rl2_IndexedCanvas const canvas, int const x0, int const y0, uint8_t const* const bg);
+
+void rl2_stampIndexed(
+    rl2_IndexedImage const image, rl2_IndexedCanvas const canvas, int const x0, int const y0,
+    uint8_t const* const remap);
+
+#endif // RL2_INDEXED_H__
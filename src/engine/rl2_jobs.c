@@ -0,0 +1,196 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include "rl2_jobs.h"
+#include "rl2_log.h"
+
+#include "rl2_thread.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#define TAG "JOB "
+
+#define RL2_MAX_WORKERS 64
+
+typedef struct {
+    rl2_Job job;
+    void* userdata;
+    size_t count;
+    size_t next;     // next index to hand out
+    size_t finished; // number of indices already run
+}
+rl2_Batch;
+
+static struct {
+    rl2_Mutex mutex;
+    rl2_Cond work;     // signaled when there's a new batch or the workers must stop
+    rl2_Cond finished; // signaled when the last index of the batch finishes
+
+    rl2_Batch* batch;
+    bool stop;
+
+    unsigned count;
+    rl2_Thread threads[RL2_MAX_WORKERS];
+}
+rl2_workers;
+
+// Runs indices of the batch until there are none left to hand out, must be called with the mutex locked
+static void rl2_runBatch(rl2_Batch* const batch) {
+    while (batch->next < batch->count) {
+        size_t const index = batch->next++;
+
+        rl2_unlock(&rl2_workers.mutex);
+        batch->job(batch->userdata, index);
+        rl2_lock(&rl2_workers.mutex);
+
+        if (++batch->finished == batch->count) {
+            rl2_broadcast(&rl2_workers.finished);
+        }
+    }
+}
+
+static RL2_THREAD_FUNC(rl2_worker) {
+    (void)arg;
+    rl2_lock(&rl2_workers.mutex);
+
+    while (!rl2_workers.stop) {
+        rl2_Batch* const batch = rl2_workers.batch;
+
+        if (batch != NULL && batch->next < batch->count) {
+            rl2_runBatch(batch);
+        }
+        else {
+            rl2_wait(&rl2_workers.work, &rl2_workers.mutex);
+        }
+    }
+
+    rl2_unlock(&rl2_workers.mutex);
+    return 0;
+}
+
+unsigned rl2_coreCount(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+#else
+    long const count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (unsigned)count : 1;
+#endif
+}
+
+// Stops the first count threads and destroys the synchronization objects, which rl2_startWorkers always initializes
+static void rl2_joinWorkers(unsigned const count) {
+    rl2_lock(&rl2_workers.mutex);
+    rl2_workers.stop = true;
+    rl2_broadcast(&rl2_workers.work);
+    rl2_unlock(&rl2_workers.mutex);
+
+    for (unsigned i = 0; i < count; i++) {
+        rl2_joinThread(rl2_workers.threads[i]);
+    }
+
+    rl2_condDestroy(&rl2_workers.finished);
+    rl2_condDestroy(&rl2_workers.work);
+    rl2_mutexDestroy(&rl2_workers.mutex);
+}
+
+bool rl2_startWorkers(unsigned count) {
+    if (rl2_workers.count != 0) {
+        RL2_WARN(TAG "workers already started");
+        return true;
+    }
+
+    if (count == 0) {
+        // The calling thread also runs jobs
+        count = rl2_coreCount() - 1;
+
+        if (count == 0) {
+            RL2_INFO(TAG "single core, jobs will run on the calling thread");
+            return true;
+        }
+    }
+
+    if (count > RL2_MAX_WORKERS) {
+        count = RL2_MAX_WORKERS;
+    }
+
+    rl2_mutexInit(&rl2_workers.mutex);
+    rl2_condInit(&rl2_workers.work);
+    rl2_condInit(&rl2_workers.finished);
+    rl2_workers.batch = NULL;
+    rl2_workers.stop = false;
+
+    for (unsigned i = 0; i < count; i++) {
+        if (!rl2_startThread(&rl2_workers.threads[i], rl2_worker)) {
+            RL2_ERROR(TAG "error creating worker thread %u", i);
+
+            rl2_joinWorkers(i);
+            return false;
+        }
+    }
+
+    rl2_workers.count = count;
+    RL2_INFO(TAG "started %u workers", count);
+    return true;
+}
+
+void rl2_stopWorkers(void) {
+    unsigned const count = rl2_workers.count;
+
+    if (count == 0) {
+        return;
+    }
+
+    rl2_joinWorkers(count);
+    rl2_workers.count = 0;
+    RL2_INFO(TAG "stopped %u workers", count);
+}
+
+unsigned rl2_workerCount(void) {
+    return rl2_workers.count;
+}
+
+static void rl2_serialFor(rl2_Job const job, void* const userdata, size_t const count) {
+    for (size_t i = 0; i < count; i++) {
+        job(userdata, i);
+    }
+}
+
+void rl2_parallelFor(rl2_Job const job, void* const userdata, size_t const count) {
+    if (rl2_workers.count == 0 || count <= 1) {
+        rl2_serialFor(job, userdata, count);
+        return;
+    }
+
+    rl2_lock(&rl2_workers.mutex);
+
+    if (rl2_workers.batch != NULL) {
+        // Another batch is running, maybe the one that called us, don't wait for the workers
+        rl2_unlock(&rl2_workers.mutex);
+        rl2_serialFor(job, userdata, count);
+        return;
+    }
+
+    rl2_Batch batch;
+    batch.job = job;
+    batch.userdata = userdata;
+    batch.count = count;
+    batch.next = 0;
+    batch.finished = 0;
+
+    rl2_workers.batch = &batch;
+    rl2_broadcast(&rl2_workers.work);
+
+    rl2_runBatch(&batch);
+
+    while (batch.finished != batch.count) {
+        rl2_wait(&rl2_workers.finished, &rl2_workers.mutex);
+    }
+
+    rl2_workers.batch = NULL;
+    rl2_unlock(&rl2_workers.mutex);
+}
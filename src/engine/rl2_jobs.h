@@ -0,0 +1,20 @@
+#ifndef RL2_JOBS_H__
+#define RL2_JOBS_H__
+
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef void (*rl2_Job)(void* const userdata, size_t const index);
+
+// Jobs run on the calling thread until workers are started, count 0 starts one worker per extra CPU core
+bool rl2_startWorkers(unsigned const count);
+void rl2_stopWorkers(void);
+unsigned rl2_workerCount(void);
+
+// Number of CPU cores online, at least one
+unsigned rl2_coreCount(void);
+
+// Runs job for every index in [0, count) on the workers and the calling thread, and returns when all are done
+void rl2_parallelFor(rl2_Job const job, void* const userdata, size_t const count);
+
+#endif // RL2_JOBS_H__
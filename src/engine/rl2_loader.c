@@ -0,0 +1,244 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include "rl2_loader.h"
+#include "rl2_font.h"
+#include "rl2_heap.h"
+#include "rl2_jobs.h"
+#include "rl2_log.h"
+#include "rl2_pixelsrc.h"
+#include "rl2_thread.h"
+
+#include <string.h>
+
+#define TAG "LDR "
+
+#define RL2_MAX_LOADERS 16
+
+struct rl2_Load {
+    rl2_Loader loader;
+    unsigned max_height;
+
+    // Protected by the loaders' mutex once loaders are started
+    rl2_LoadStatus status;
+    void* asset;
+    rl2_Load next;
+
+    char path[1];
+};
+
+static struct {
+    rl2_Mutex mutex;
+    rl2_Cond work; // signaled when a load is queued or the loaders must stop
+    rl2_Cond done; // signaled when a load finishes
+
+    // Queued loads that haven't started yet
+    rl2_Load first;
+    rl2_Load last;
+    bool stop;
+
+    unsigned count;
+    rl2_Thread threads[RL2_MAX_LOADERS];
+}
+rl2_loaders;
+
+// Runs the load and publishes its result, must be called with the mutex locked on loader threads
+static void rl2_runLoad(rl2_Load const load, bool const threaded) {
+    if (threaded) {
+        rl2_unlock(&rl2_loaders.mutex);
+    }
+
+    RL2_DEBUG(TAG "loading \"%s\"", load->path);
+    void* const asset = load->loader(load->path, load->max_height);
+
+    if (threaded) {
+        rl2_lock(&rl2_loaders.mutex);
+    }
+
+    load->asset = asset;
+    load->status = asset != NULL ? RL2_LOAD_DONE : RL2_LOAD_FAILED;
+
+    if (threaded) {
+        rl2_broadcast(&rl2_loaders.done);
+    }
+}
+
+static RL2_THREAD_FUNC(rl2_loaderThread) {
+    (void)arg;
+    rl2_lock(&rl2_loaders.mutex);
+
+    for (;;) {
+        rl2_Load const load = rl2_loaders.first;
+
+        if (load != NULL) {
+            rl2_loaders.first = load->next;
+
+            if (rl2_loaders.first == NULL) {
+                rl2_loaders.last = NULL;
+            }
+
+            rl2_runLoad(load, true);
+        }
+        else if (rl2_loaders.stop) {
+            // Only stop when the queue is empty so that all handles complete
+            break;
+        }
+        else {
+            rl2_wait(&rl2_loaders.work, &rl2_loaders.mutex);
+        }
+    }
+
+    rl2_unlock(&rl2_loaders.mutex);
+    return 0;
+}
+
+// Stops the first count threads and destroys the synchronization objects, which rl2_startLoaders always initializes
+static void rl2_joinLoaders(unsigned const count) {
+    rl2_lock(&rl2_loaders.mutex);
+    rl2_loaders.stop = true;
+    rl2_broadcast(&rl2_loaders.work);
+    rl2_unlock(&rl2_loaders.mutex);
+
+    for (unsigned i = 0; i < count; i++) {
+        rl2_joinThread(rl2_loaders.threads[i]);
+    }
+
+    rl2_condDestroy(&rl2_loaders.done);
+    rl2_condDestroy(&rl2_loaders.work);
+    rl2_mutexDestroy(&rl2_loaders.mutex);
+}
+
+bool rl2_startLoaders(unsigned count) {
+    if (rl2_loaders.count != 0) {
+        RL2_WARN(TAG "loaders already started");
+        return true;
+    }
+
+    if (count == 0) {
+        // Decoding overlaps with the calling thread, so use at least one loader even on a single core
+        count = rl2_coreCount() > 1 ? rl2_coreCount() - 1 : 1;
+    }
+
+    if (count > RL2_MAX_LOADERS) {
+        count = RL2_MAX_LOADERS;
+    }
+
+    rl2_mutexInit(&rl2_loaders.mutex);
+    rl2_condInit(&rl2_loaders.work);
+    rl2_condInit(&rl2_loaders.done);
+    rl2_loaders.first = rl2_loaders.last = NULL;
+    rl2_loaders.stop = false;
+
+    for (unsigned i = 0; i < count; i++) {
+        if (!rl2_startThread(&rl2_loaders.threads[i], rl2_loaderThread)) {
+            RL2_ERROR(TAG "error creating loader thread %u", i);
+
+            rl2_joinLoaders(i);
+            return false;
+        }
+    }
+
+    rl2_loaders.count = count;
+    RL2_INFO(TAG "started %u loaders", count);
+    return true;
+}
+
+void rl2_stopLoaders(void) {
+    unsigned const count = rl2_loaders.count;
+
+    if (count == 0) {
+        return;
+    }
+
+    rl2_joinLoaders(count);
+    rl2_loaders.count = 0;
+    RL2_INFO(TAG "stopped %u loaders", count);
+}
+
+rl2_Load rl2_load(rl2_Loader const loader, char const* const path, unsigned const max_height) {
+    size_t const path_len = strlen(path);
+    rl2_Load const load = (rl2_Load)rl2_alloc(sizeof(*load) + path_len);
+
+    if (load == NULL) {
+        RL2_ERROR(TAG "out of memory loading \"%s\"", path);
+        return NULL;
+    }
+
+    load->loader = loader;
+    load->max_height = max_height;
+    load->status = RL2_LOAD_PENDING;
+    load->asset = NULL;
+    load->next = NULL;
+    memcpy(load->path, path, path_len + 1);
+
+    if (rl2_loaders.count == 0) {
+        rl2_runLoad(load, false);
+        return load;
+    }
+
+    rl2_lock(&rl2_loaders.mutex);
+
+    if (rl2_loaders.last != NULL) {
+        rl2_loaders.last->next = load;
+    }
+    else {
+        rl2_loaders.first = load;
+    }
+
+    rl2_loaders.last = load;
+    rl2_broadcast(&rl2_loaders.work);
+    rl2_unlock(&rl2_loaders.mutex);
+    return load;
+}
+
+static void* rl2_readPixelSourceAsset(char const* const path, unsigned const max_height) {
+    return rl2_readPixelSource(path, max_height);
+}
+
+static void* rl2_readFontAsset(char const* const path, unsigned const max_height) {
+    return rl2_readFont(path, max_height);
+}
+
+rl2_Load rl2_loadPixelSource(char const* const path, unsigned const max_height) {
+    return rl2_load(rl2_readPixelSourceAsset, path, max_height);
+}
+
+rl2_Load rl2_loadFont(char const* const path, unsigned const max_height) {
+    return rl2_load(rl2_readFontAsset, path, max_height);
+}
+
+rl2_LoadStatus rl2_loadStatus(rl2_Load const load) {
+    if (rl2_loaders.count == 0) {
+        return load->status;
+    }
+
+    rl2_lock(&rl2_loaders.mutex);
+    rl2_LoadStatus const status = load->status;
+    rl2_unlock(&rl2_loaders.mutex);
+    return status;
+}
+
+rl2_LoadStatus rl2_waitLoad(rl2_Load const load) {
+    if (rl2_loaders.count == 0) {
+        return load->status;
+    }
+
+    rl2_lock(&rl2_loaders.mutex);
+
+    while (load->status == RL2_LOAD_PENDING) {
+        rl2_wait(&rl2_loaders.done, &rl2_loaders.mutex);
+    }
+
+    rl2_LoadStatus const status = load->status;
+    rl2_unlock(&rl2_loaders.mutex);
+    return status;
+}
+
+void* rl2_finishLoad(rl2_Load const load) {
+    rl2_waitLoad(load);
+
+    void* const asset = load->asset;
+    rl2_free(load);
+    return asset;
+}
@@ -0,0 +1,39 @@
+#ifndef RL2_LOADER_H__
+#define RL2_LOADER_H__
+
+#include <stdbool.h>
+
+typedef struct rl2_Load* rl2_Load;
+
+// Decodes the asset at path from the file systems up to max_height, returns NULL on errors; runs on a loader thread
+typedef void* (*rl2_Loader)(char const* const path, unsigned const max_height);
+
+typedef enum {
+    RL2_LOAD_PENDING,
+    RL2_LOAD_DONE,
+    RL2_LOAD_FAILED
+}
+rl2_LoadStatus;
+
+// Loads run on the calling thread until loaders are started, count 0 starts one loader per extra CPU core. File
+// systems must not be destroyed while loads are pending
+bool rl2_startLoaders(unsigned const count);
+
+// Finishes the queued loads before returning
+void rl2_stopLoaders(void);
+
+// Queues a load and returns its handle, or NULL if out of memory; loads start in the order they're queued
+rl2_Load rl2_load(rl2_Loader const loader, char const* const path, unsigned const max_height);
+
+// Same as rl2_load with rl2_readPixelSource (PNG and JPEG) and rl2_readFont (BDF)
+rl2_Load rl2_loadPixelSource(char const* const path, unsigned const max_height);
+rl2_Load rl2_loadFont(char const* const path, unsigned const max_height);
+
+// Returns the status without blocking, or blocks until the load is done
+rl2_LoadStatus rl2_loadStatus(rl2_Load const load);
+rl2_LoadStatus rl2_waitLoad(rl2_Load const load);
+
+// Waits for the load and destroys its handle, returns the asset which now belongs to the caller or NULL if it failed
+void* rl2_finishLoad(rl2_Load const load);
+
+#endif // RL2_LOADER_H__
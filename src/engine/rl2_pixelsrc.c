@@ -1,6 +1,8 @@
 #include "rl2_pixelsrc.h"
 #include "rl2_log.h"
 #include "rl2_heap.h"
+#include "rl2_jobs.h"
+#include "rl2_span.h"
 
 #include <png.h>
 #include <stdio.h> // needed by jpeglib.h
@@ -13,6 +15,10 @@
 
 #define TAG "PXS "
 
+// Rotations transpose tiles of this many pixels per side, small enough for a source and a destination tile to stay
+// in L1; each job does a band of this many source rows
+#define RL2_TRANSFORM_TILE 32
+
 // Image read is coded for 32 bpp, make sure the build fails if hh2_ARGB8888 does not have 32 bits
 typedef char rl2_staticAssertPixelMustHave32Bits[sizeof(rl2_ARGB8888) == 4 ? 1 : -1];
 
@@ -38,6 +44,18 @@ typedef struct {
 }
 rl2_Reader;
 
+typedef struct {
+    rl2_ARGB8888* dst;
+    ptrdiff_t dst_pitch;
+    rl2_ARGB8888 const* src;
+    ptrdiff_t src_pitch;
+    unsigned width;
+    unsigned height;
+    bool transpose;
+    bool reverse;
+}
+rl2_Transform;
+
 static size_t rl2_readFromReader(rl2_Reader* const reader, void* const buffer, size_t const size) {
     if (reader->file != NULL) {
         return rl2_read(reader->file, buffer, size);
@@ -522,6 +540,86 @@ rl2_PixelSource rl2_subPixelSource(
     return source;
 }
 
+static void rl2_transformJob(void* const userdata, size_t const index) {
+    rl2_Transform const* const transform = (rl2_Transform const*)userdata;
+    unsigned const first = (unsigned)index * RL2_TRANSFORM_TILE;
+    unsigned const last = first + RL2_TRANSFORM_TILE < transform->height ? first + RL2_TRANSFORM_TILE : transform->height;
+
+    if (transform->transpose) {
+        // Source columns become destination rows
+        for (unsigned x = 0; x < transform->width; x += RL2_TRANSFORM_TILE) {
+            unsigned const width = x + RL2_TRANSFORM_TILE < transform->width ? RL2_TRANSFORM_TILE : transform->width - x;
+
+            rl2_transposeBlock(
+                transform->dst + (ptrdiff_t)x * transform->dst_pitch + first, transform->dst_pitch,
+                transform->src + (ptrdiff_t)first * transform->src_pitch + x, transform->src_pitch, width,
+                last - first);
+        }
+
+        return;
+    }
+
+    for (unsigned y = first; y < last; y++) {
+        rl2_ARGB8888* const dst = transform->dst + (ptrdiff_t)y * transform->dst_pitch;
+        rl2_ARGB8888 const* const src = transform->src + (ptrdiff_t)y * transform->src_pitch;
+
+        if (transform->reverse) {
+            rl2_reverseSpan(dst, src, transform->width);
+        }
+        else {
+            memcpy(dst, src, transform->width * sizeof(*dst));
+        }
+    }
+}
+
+rl2_PixelSource rl2_transformPixelSource(rl2_PixelSource const parent, rl2_PixelSourceTransform const transform) {
+    unsigned const width = parent->width;
+    unsigned const height = parent->height;
+    bool const rotate = transform == RL2_PIXELSOURCE_ROTATE_90 || transform == RL2_PIXELSOURCE_ROTATE_270;
+
+    if ((unsigned)transform > RL2_PIXELSOURCE_ROTATE_VERTICAL_FLIP) {
+        RL2_ERROR(TAG "invalid pixel source transform %d", transform);
+        return NULL;
+    }
+
+    rl2_PixelSource const source = rl2_newPixelSource(rotate ? height : width, rotate ? width : height);
+
+    if (source == NULL) {
+        // Error already logged
+        return NULL;
+    }
+
+    // Rotations are transposes with the source or the destination walked upwards, flips copy rows reversed or in
+    // reverse order; the parent's pitch takes care of sub pixel sources
+    rl2_Transform job;
+    job.dst = source->abgr;
+    job.dst_pitch = (ptrdiff_t)source->pitch;
+    job.src = parent->abgr;
+    job.src_pitch = (ptrdiff_t)parent->pitch;
+    job.width = width;
+    job.height = height;
+    job.transpose = rotate;
+    job.reverse = transform == RL2_PIXELSOURCE_ROTATE_180 || transform == RL2_PIXELSOURCE_ROTATE_HORIZONTAL_FLIP;
+
+    if (transform == RL2_PIXELSOURCE_ROTATE_90) {
+        // Clockwise, the bottom row of the source is the left column of the destination
+        job.src += (ptrdiff_t)(height - 1) * job.src_pitch;
+        job.src_pitch = -job.src_pitch;
+    }
+    else if (transform == RL2_PIXELSOURCE_ROTATE_270) {
+        // The right column of the source is the top row of the destination
+        job.dst += (ptrdiff_t)(width - 1) * job.dst_pitch;
+        job.dst_pitch = -job.dst_pitch;
+    }
+    else if (transform == RL2_PIXELSOURCE_ROTATE_180 || transform == RL2_PIXELSOURCE_ROTATE_VERTICAL_FLIP) {
+        job.dst += (ptrdiff_t)(height - 1) * job.dst_pitch;
+        job.dst_pitch = -job.dst_pitch;
+    }
+
+    rl2_parallelFor(rl2_transformJob, &job, (height + RL2_TRANSFORM_TILE - 1) / RL2_TRANSFORM_TILE);
+    return source;
+}
+
 void rl2_destroyPixelSource(rl2_PixelSource const source) {
 #ifdef RL2_BUILD_DEBUG
     rl2_free((void*)source->path);
@@ -538,6 +636,19 @@ unsigned rl2_pixelSourceHeight(rl2_PixelSource const source) {
     return source->height;
 }
 
+rl2_ARGB8888* rl2_pixelSourceRow(rl2_PixelSource const source, unsigned const y) {
+    if (y < source->height) {
+        return source->abgr + y * source->pitch;
+    }
+
+    RL2_WARN(TAG "row outside bounds: %u", y);
+    return NULL;
+}
+
+size_t rl2_pixelSourcePitch(rl2_PixelSource const source) {
+    return source->pitch;
+}
+
 rl2_ARGB8888 rl2_getPixel(rl2_PixelSource const source, unsigned const x, unsigned const y) {
     unsigned const width = source->width;
     unsigned const height = source->height;
@@ -550,33 +661,119 @@ rl2_ARGB8888 rl2_getPixel(rl2_PixelSource const source, unsigned const x, unsign
     return 0;
 }
 
-void rl2_fillPixelSource(rl2_PixelSource const source, rl2_ARGB8888 const color) {
+void rl2_putPixel(rl2_PixelSource const source, unsigned const x, unsigned const y, rl2_ARGB8888 const color) {
     unsigned const width = source->width;
     unsigned const height = source->height;
-    size_t const pitch = source->pitch;
-    rl2_ARGB8888* pixel = source->abgr;
 
-    for (unsigned y = 0; y < height; y++) {
-        rl2_ARGB8888* const saved_pixel = pixel;
+    if (x < width && y < height) {
+        source->abgr[y * source->pitch + x] = color;
+        return;
+    }
 
-        for (unsigned x = 0; x < width; x++) {
-            *pixel++ = color;
-        }
+    RL2_WARN(TAG "pixel coordinates outside bounds: %u, %u", x, y);
+}
+
+// Clips the width by height rectangle at (x0, y0) to the source, returns false if nothing is left; the offsets of
+// the clipped rectangle inside the original one are returned in dx and dy
+static bool rl2_clipPixelRect(
+    rl2_PixelSource const source, int* const x0, int* const y0, unsigned* const width, unsigned* const height,
+    unsigned* const dx, unsigned* const dy) {
 
-        pixel = saved_pixel + pitch;
+    int64_t const left = *x0 > 0 ? *x0 : 0;
+    int64_t const top = *y0 > 0 ? *y0 : 0;
+    int64_t const right = (int64_t)*x0 + *width < source->width ? (int64_t)*x0 + *width : source->width;
+    int64_t const bottom = (int64_t)*y0 + *height < source->height ? (int64_t)*y0 + *height : source->height;
+
+    if (left >= right || top >= bottom) {
+        return false;
     }
+
+    *dx = (unsigned)(left - *x0);
+    *dy = (unsigned)(top - *y0);
+    *x0 = (int)left;
+    *y0 = (int)top;
+    *width = (unsigned)(right - left);
+    *height = (unsigned)(bottom - top);
+    return true;
 }
 
-void rl2_putPixel(rl2_PixelSource const source, unsigned const x, unsigned const y, rl2_ARGB8888 const color) {
-    unsigned const width = source->width;
-    unsigned const height = source->height;
+void rl2_fillPixelSource(rl2_PixelSource const source, rl2_ARGB8888 const color) {
+    rl2_fillPixelRect(source, 0, 0, source->width, source->height, color);
+}
 
-    if (x < width && y < height) {
-        source->abgr[y * source->pitch + x] = color;
+void rl2_fillPixelRect(
+    rl2_PixelSource const source, int const x0, int const y0, unsigned const width, unsigned const height,
+    rl2_ARGB8888 const color) {
+
+    int left = x0, top = y0;
+    unsigned clipped_width = width, clipped_height = height, dx, dy;
+
+    if (!rl2_clipPixelRect(source, &left, &top, &clipped_width, &clipped_height, &dx, &dy)) {
         return;
     }
 
-    RL2_WARN(TAG "pixel coordinates outside bounds: %u, %u", x, y);
+    // Fill the first row and copy it to the others
+    rl2_ARGB8888* const first = source->abgr + top * source->pitch + left;
+
+    for (unsigned x = 0; x < clipped_width; x++) {
+        first[x] = color;
+    }
+
+    for (unsigned y = 1; y < clipped_height; y++) {
+        memcpy(first + y * source->pitch, first, clipped_width * sizeof(*first));
+    }
+}
+
+void rl2_copyPixels(rl2_PixelSource const dst, int const x0, int const y0, rl2_PixelSource const src) {
+    int left = x0, top = y0;
+    unsigned width = src->width, height = src->height, dx, dy;
+
+    if (!rl2_clipPixelRect(dst, &left, &top, &width, &height, &dx, &dy)) {
+        return;
+    }
+
+    rl2_ARGB8888* const to = dst->abgr + top * dst->pitch + left;
+    rl2_ARGB8888 const* const from = src->abgr + dy * src->pitch + dx;
+
+    if (to > from) {
+        // Sub pixel sources of the same parent can overlap, copy bottom up when moving pixels down
+        for (unsigned y = height; y-- != 0;) {
+            memmove(to + y * dst->pitch, from + y * src->pitch, width * sizeof(*to));
+        }
+    }
+    else {
+        for (unsigned y = 0; y < height; y++) {
+            memmove(to + y * dst->pitch, from + y * src->pitch, width * sizeof(*to));
+        }
+    }
+}
+
+void rl2_blendPixels(rl2_PixelSource const dst, int const x0, int const y0, rl2_PixelSource const src) {
+    int left = x0, top = y0;
+    unsigned width = src->width, height = src->height, dx, dy;
+
+    if (!rl2_clipPixelRect(dst, &left, &top, &width, &height, &dx, &dy)) {
+        return;
+    }
+
+    rl2_ARGB8888* const to = dst->abgr + top * dst->pitch + left;
+    rl2_ARGB8888 const* const from = src->abgr + dy * src->pitch + dx;
+
+    for (unsigned y = 0; y < height; y++) {
+        rl2_blendArgbSpan(to + y * dst->pitch, from + y * src->pitch, width);
+    }
+}
+
+void rl2_rgb565PixelSource(rl2_PixelSource const source, uint16_t* const dst, size_t const pitch, bool const dither) {
+    // 4x4 Bayer matrix, one row per word with the threshold for column x in byte x
+    static uint32_t const bayer[4] = {
+        UINT32_C(0x0a020800), UINT32_C(0x060e040c), UINT32_C(0x09010b03), UINT32_C(0x050d070f)
+    };
+
+    for (unsigned y = 0; y < source->height; y++) {
+        uint16_t* const row = (uint16_t*)((uint8_t*)dst + y * pitch);
+        rl2_rgb565Span(row, source->abgr + y * source->pitch, source->width, dither ? bayer[y & 3] : 0);
+    }
 }
 
 #ifdef RL2_BUILD_DEBUG
@@ -3,6 +3,7 @@
 
 #include "rl2_filesys.h"
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -31,6 +32,8 @@ rl2_PixelSource rl2_readPixelSource(char const* const path, unsigned const max_h
 rl2_PixelSource rl2_subPixelSource(
     rl2_PixelSource const parent, unsigned const x0, unsigned const y0, unsigned const width, unsigned const height);
 
+// Creates a new pixel source with the pixels of parent rotated clockwise or flipped; parent can be a sub pixel source
+// and is left untouched. Large sources are transformed in bands on the workers
 rl2_PixelSource rl2_transformPixelSource(rl2_PixelSource const parent, rl2_PixelSourceTransform const transform);
 
 void rl2_destroyPixelSource(rl2_PixelSource const source);
@@ -38,10 +41,32 @@ void rl2_destroyPixelSource(rl2_PixelSource const source);
 unsigned rl2_pixelSourceWidth(rl2_PixelSource const source);
 unsigned rl2_pixelSourceHeight(rl2_PixelSource const source);
 
+// Pointer to the first pixel of row y, rows are rl2_pixelSourceWidth pixels long
+rl2_ARGB8888* rl2_pixelSourceRow(rl2_PixelSource const source, unsigned const y);
+
+// Distance in pixels between the starts of consecutive rows, larger than the width for sub pixel sources; lets
+// loops walk the rows from rl2_pixelSourceRow(source, 0) without a bounds check per row or pixel
+size_t rl2_pixelSourcePitch(rl2_PixelSource const source);
+
 rl2_ARGB8888 rl2_getPixel(rl2_PixelSource const source, unsigned const x, unsigned const y);
-void rl2_fillPixelSource(rl2_PixelSource const source, rl2_ARGB8888 const color);
 void rl2_putPixel(rl2_PixelSource const source, unsigned const x, unsigned const y, rl2_ARGB8888 const color);
 
+// Bulk operations, clipped to the destination; rectangles of a source are done with rl2_subPixelSource
+void rl2_fillPixelSource(rl2_PixelSource const source, rl2_ARGB8888 const color);
+void rl2_fillPixelRect(
+    rl2_PixelSource const source, int const x0, int const y0, unsigned const width, unsigned const height,
+    rl2_ARGB8888 const color);
+
+// Copies src to dst at (x0, y0), they can be overlapping sub pixel sources of the same parent
+void rl2_copyPixels(rl2_PixelSource const dst, int const x0, int const y0, rl2_PixelSource const src);
+
+// Blends the non-premultiplied src over dst at (x0, y0), they must not overlap
+void rl2_blendPixels(rl2_PixelSource const dst, int const x0, int const y0, rl2_PixelSource const src);
+
+// Writes the pixels as RGB565 to dst, pitch is in bytes; dither adds a 4x4 ordered dither to hide the banding of
+// gradients
+void rl2_rgb565PixelSource(rl2_PixelSource const source, uint16_t* const dst, size_t const pitch, bool const dither);
+
 #ifdef RL2_BUILD_DEBUG
     char const* rl2_getPixelSourcePath(rl2_PixelSource const source);
 #endif
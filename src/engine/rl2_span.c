@@ -0,0 +1,1393 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include "rl2_span.h"
+#include "rl2_cpu.h"
+#include "rl2_thread.h"
+
+#include <stdbool.h>
+
+#if defined(RL2_SIMD_X86)
+#include <emmintrin.h>
+#include <immintrin.h>
+#elif defined(RL2_SIMD_NEON)
+#include <arm_neon.h>
+#endif
+
+static void rl2_alphaLevelsScalar(uint8_t* const levels, rl2_ARGB8888 const* const src, size_t const count) {
+    for (size_t i = 0; i < count; i++) {
+        levels[i] = ((uint16_t)RL2_ARGB8888_A(src[i]) + 4) / 8;
+    }
+}
+
+#ifdef RL2_SIMD_X86
+RL2_TARGET_SSE2 static void rl2_alphaLevelsSse2(uint8_t* const levels, rl2_ARGB8888 const* const src, size_t const count) {
+    __m128i const four = _mm_set1_epi16(4);
+    size_t i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        __m128i const a0 = _mm_srli_epi32(_mm_loadu_si128((__m128i const*)(src + i)), 24);
+        __m128i const a1 = _mm_srli_epi32(_mm_loadu_si128((__m128i const*)(src + i + 4)), 24);
+        __m128i const a2 = _mm_srli_epi32(_mm_loadu_si128((__m128i const*)(src + i + 8)), 24);
+        __m128i const a3 = _mm_srli_epi32(_mm_loadu_si128((__m128i const*)(src + i + 12)), 24);
+
+        __m128i const lo = _mm_srli_epi16(_mm_add_epi16(_mm_packs_epi32(a0, a1), four), 3);
+        __m128i const hi = _mm_srli_epi16(_mm_add_epi16(_mm_packs_epi32(a2, a3), four), 3);
+        _mm_storeu_si128((__m128i*)(levels + i), _mm_packus_epi16(lo, hi));
+    }
+
+    rl2_alphaLevelsScalar(levels + i, src + i, count - i);
+}
+
+RL2_TARGET_SSE2 static __m128i rl2_div255Sse2(__m128i const t) {
+    // Exact t / 255 for t <= 255 * 255
+    return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(t, _mm_set1_epi16(1)), _mm_srli_epi16(t, 8)), 8);
+}
+
+RL2_TARGET_SSE2 static __m128i rl2_rgb565Sse2(__m128i const pixels) {
+    __m128i const r = _mm_slli_epi32(_mm_and_si128(pixels, _mm_set1_epi32(0xf8)), 8);
+    __m128i const g = _mm_and_si128(_mm_srli_epi32(pixels, 5), _mm_set1_epi32(0x07e0));
+    __m128i const b = _mm_and_si128(_mm_srli_epi32(pixels, 19), _mm_set1_epi32(0x1f));
+    __m128i const rgb = _mm_or_si128(_mm_or_si128(r, g), b);
+
+    // Sign-extend so that _mm_packs_epi32 doesn't saturate colors with the top bit set
+    return _mm_srai_epi32(_mm_slli_epi32(rgb, 16), 16);
+}
+#endif
+
+#ifdef RL2_SIMD_NEON
+static void rl2_alphaLevelsNeon(uint8_t* const levels, rl2_ARGB8888 const* const src, size_t const count) {
+    size_t i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        uint8x16x4_t const p = vld4q_u8((uint8_t const*)(src + i));
+        // Rounding shift, (alpha + 4) >> 3 without overflowing
+        vst1q_u8(levels + i, vrshrq_n_u8(p.val[3], 3));
+    }
+
+    rl2_alphaLevelsScalar(levels + i, src + i, count - i);
+}
+
+static uint8x8_t rl2_div255Neon(uint16x8_t const t) {
+    // Exact t / 255 for t <= 255 * 255
+    return vshrn_n_u16(vaddq_u16(vaddq_u16(t, vdupq_n_u16(1)), vshrq_n_u16(t, 8)), 8);
+}
+
+static uint16x8_t rl2_rgb565Neon(uint8x8_t const r, uint8x8_t const g, uint8x8_t const b) {
+    uint16x8_t rgb = vshll_n_u8(r, 8);
+    rgb = vsriq_n_u16(rgb, vshll_n_u8(g, 8), 5);
+    return vsriq_n_u16(rgb, vshll_n_u8(b, 8), 11);
+}
+#endif
+
+// Pixel source transforms, on 32-bit words so they're the same for all canvas formats
+
+static void rl2_reverseSpanScalar(rl2_ARGB8888* const dst, rl2_ARGB8888 const* const src, size_t const count) {
+    for (size_t i = 0; i < count; i++) {
+        dst[i] = src[count - 1 - i];
+    }
+}
+
+static void rl2_transposeBlockScalar(
+    rl2_ARGB8888* const dst, ptrdiff_t const dst_pitch, rl2_ARGB8888 const* const src, ptrdiff_t const src_pitch,
+    unsigned const width, unsigned const height) {
+
+    // Indices are cast before multiplying by the pitch, which can be negative, so that ILP32 targets don't wrap
+    for (unsigned y = 0; y < height; y++) {
+        rl2_ARGB8888 const* const row = src + (ptrdiff_t)y * src_pitch;
+        rl2_ARGB8888* const column = dst + y;
+
+        for (unsigned x = 0; x < width; x++) {
+            column[(ptrdiff_t)x * dst_pitch] = row[x];
+        }
+    }
+}
+
+#ifdef RL2_SIMD_X86
+RL2_TARGET_SSE2 static void rl2_reverseSpanSse2(rl2_ARGB8888* const dst, rl2_ARGB8888 const* const src, size_t const count) {
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m128i const p = _mm_loadu_si128((__m128i const*)(src + count - 4 - i));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_shuffle_epi32(p, _MM_SHUFFLE(0, 1, 2, 3)));
+    }
+
+    rl2_reverseSpanScalar(dst + i, src, count - i);
+}
+
+// Transposes 4x4 blocks in registers, the edges that don't fill a block are done one pixel at a time
+RL2_TARGET_SSE2 static void rl2_transposeBlockSse2(
+    rl2_ARGB8888* const dst, ptrdiff_t const dst_pitch, rl2_ARGB8888 const* const src, ptrdiff_t const src_pitch,
+    unsigned const width, unsigned const height) {
+
+    unsigned const width4 = width & ~3U, height4 = height & ~3U;
+
+    for (unsigned y = 0; y < height4; y += 4) {
+        for (unsigned x = 0; x < width4; x += 4) {
+            rl2_ARGB8888 const* const in = src + (ptrdiff_t)y * src_pitch + x;
+            __m128i const r0 = _mm_loadu_si128((__m128i const*)in);
+            __m128i const r1 = _mm_loadu_si128((__m128i const*)(in + src_pitch));
+            __m128i const r2 = _mm_loadu_si128((__m128i const*)(in + 2 * src_pitch));
+            __m128i const r3 = _mm_loadu_si128((__m128i const*)(in + 3 * src_pitch));
+
+            __m128i const t0 = _mm_unpacklo_epi32(r0, r1);
+            __m128i const t1 = _mm_unpacklo_epi32(r2, r3);
+            __m128i const t2 = _mm_unpackhi_epi32(r0, r1);
+            __m128i const t3 = _mm_unpackhi_epi32(r2, r3);
+
+            rl2_ARGB8888* const out = dst + (ptrdiff_t)x * dst_pitch + y;
+            _mm_storeu_si128((__m128i*)out, _mm_unpacklo_epi64(t0, t1));
+            _mm_storeu_si128((__m128i*)(out + dst_pitch), _mm_unpackhi_epi64(t0, t1));
+            _mm_storeu_si128((__m128i*)(out + 2 * dst_pitch), _mm_unpacklo_epi64(t2, t3));
+            _mm_storeu_si128((__m128i*)(out + 3 * dst_pitch), _mm_unpackhi_epi64(t2, t3));
+        }
+
+        rl2_transposeBlockScalar(
+            dst + (ptrdiff_t)width4 * dst_pitch + y, dst_pitch, src + (ptrdiff_t)y * src_pitch + width4, src_pitch,
+            width - width4, 4);
+    }
+
+    rl2_transposeBlockScalar(
+        dst + height4, dst_pitch, src + (ptrdiff_t)height4 * src_pitch, src_pitch, width, height - height4);
+}
+#endif
+
+#ifdef RL2_SIMD_NEON
+static void rl2_reverseSpanNeon(rl2_ARGB8888* const dst, rl2_ARGB8888 const* const src, size_t const count) {
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        uint32x4_t const p = vrev64q_u32(vld1q_u32(src + count - 4 - i));
+        vst1q_u32(dst + i, vextq_u32(p, p, 2));
+    }
+
+    rl2_reverseSpanScalar(dst + i, src, count - i);
+}
+
+static void rl2_transposeBlockNeon(
+    rl2_ARGB8888* const dst, ptrdiff_t const dst_pitch, rl2_ARGB8888 const* const src, ptrdiff_t const src_pitch,
+    unsigned const width, unsigned const height) {
+
+    unsigned const width4 = width & ~3U, height4 = height & ~3U;
+
+    for (unsigned y = 0; y < height4; y += 4) {
+        for (unsigned x = 0; x < width4; x += 4) {
+            rl2_ARGB8888 const* const in = src + (ptrdiff_t)y * src_pitch + x;
+            uint32x4x2_t const t01 = vtrnq_u32(vld1q_u32(in), vld1q_u32(in + src_pitch));
+            uint32x4x2_t const t23 = vtrnq_u32(vld1q_u32(in + 2 * src_pitch), vld1q_u32(in + 3 * src_pitch));
+
+            rl2_ARGB8888* const out = dst + (ptrdiff_t)x * dst_pitch + y;
+            vst1q_u32(out, vcombine_u32(vget_low_u32(t01.val[0]), vget_low_u32(t23.val[0])));
+            vst1q_u32(out + dst_pitch, vcombine_u32(vget_low_u32(t01.val[1]), vget_low_u32(t23.val[1])));
+            vst1q_u32(out + 2 * dst_pitch, vcombine_u32(vget_high_u32(t01.val[0]), vget_high_u32(t23.val[0])));
+            vst1q_u32(out + 3 * dst_pitch, vcombine_u32(vget_high_u32(t01.val[1]), vget_high_u32(t23.val[1])));
+        }
+
+        rl2_transposeBlockScalar(
+            dst + (ptrdiff_t)width4 * dst_pitch + y, dst_pitch, src + (ptrdiff_t)y * src_pitch + width4, src_pitch,
+            width - width4, 4);
+    }
+
+    rl2_transposeBlockScalar(
+        dst + height4, dst_pitch, src + (ptrdiff_t)height4 * src_pitch, src_pitch, width, height - height4);
+}
+#endif
+
+// Pixel source blending and RGB565 output, also on 32-bit words
+
+static void rl2_blendArgbSpanScalar(rl2_ARGB8888* const dst, rl2_ARGB8888 const* const src, size_t const count) {
+    for (size_t i = 0; i < count; i++) {
+        // The source alpha channel is taken as 255 so that the result's alpha is a + da * (255 - a) / 255
+        rl2_ARGB8888 const s = src[i] | UINT32_C(0xff000000), d = dst[i];
+        uint32_t const a = RL2_ARGB8888_A(src[i]), inv_a = 255 - a;
+        rl2_ARGB8888 blended = 0;
+
+        for (unsigned shift = 0; shift < 32; shift += 8) {
+            uint32_t const c = (((s >> shift) & 255) * a + ((d >> shift) & 255) * inv_a) / 255;
+            blended |= c << shift;
+        }
+
+        dst[i] = blended;
+    }
+}
+
+static void rl2_rgb565SpanScalar(uint16_t* const dst, rl2_ARGB8888 const* const src, size_t const count, uint32_t const dither) {
+    for (size_t i = 0; i < count; i++) {
+        rl2_ARGB8888 const pixel = src[i];
+        unsigned const threshold = (dither >> ((i & 3) * 8)) & 15;
+        unsigned const r = RL2_ARGB8888_R(pixel) + threshold / 2;
+        unsigned const g = RL2_ARGB8888_G(pixel) + threshold / 4;
+        unsigned const b = RL2_ARGB8888_B(pixel) + threshold / 2;
+        dst[i] = RL2_COLOR_RGB565(r < 255 ? r : 255, g < 255 ? g : 255, b < 255 ? b : 255);
+    }
+}
+
+#ifdef RL2_SIMD_X86
+RL2_TARGET_SSE2 static __m128i rl2_blendArgbSse2(__m128i const s, __m128i const d, __m128i const a) {
+    __m128i const inv_a = _mm_xor_si128(a, _mm_set1_epi16(255));
+    return rl2_div255Sse2(_mm_add_epi16(_mm_mullo_epi16(s, a), _mm_mullo_epi16(d, inv_a)));
+}
+
+RL2_TARGET_SSE2 static void rl2_blendArgbSpanSse2(rl2_ARGB8888* const dst, rl2_ARGB8888 const* const src, size_t const count) {
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const opaque = _mm_set1_epi32((int)0xff000000);
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m128i const p = _mm_loadu_si128((__m128i const*)(src + i));
+        __m128i const s = _mm_or_si128(p, opaque);
+        __m128i const d = _mm_loadu_si128((__m128i const*)(dst + i));
+
+        // Two pixels per register in 16-bit lanes, alpha broadcast to the four channels of each
+        __m128i const s_lo = _mm_unpacklo_epi8(s, zero), s_hi = _mm_unpackhi_epi8(s, zero);
+        __m128i const d_lo = _mm_unpacklo_epi8(d, zero), d_hi = _mm_unpackhi_epi8(d, zero);
+        __m128i const p_lo = _mm_unpacklo_epi8(p, zero), p_hi = _mm_unpackhi_epi8(p, zero);
+
+        __m128i const a_lo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(p_lo, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+        __m128i const a_hi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(p_hi, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+
+        __m128i const lo = rl2_blendArgbSse2(s_lo, d_lo, a_lo);
+        __m128i const hi = rl2_blendArgbSse2(s_hi, d_hi, a_hi);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(lo, hi));
+    }
+
+    rl2_blendArgbSpanScalar(dst + i, src + i, count - i);
+}
+
+RL2_TARGET_SSE2 static void rl2_rgb565SpanSse2(
+    uint16_t* const dst, rl2_ARGB8888 const* const src, size_t const count, uint32_t const dither) {
+
+    // Per-channel thresholds for the four pixels in a register, added with saturation before truncating
+    uint32_t thresholds[4];
+
+    for (unsigned j = 0; j < 4; j++) {
+        uint32_t const threshold = (dither >> (j * 8)) & 15;
+        thresholds[j] = threshold / 2 | (threshold / 4) << 8 | (threshold / 2) << 16;
+    }
+
+    __m128i const t = _mm_loadu_si128((__m128i const*)thresholds);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m128i const p0 = rl2_rgb565Sse2(_mm_adds_epu8(_mm_loadu_si128((__m128i const*)(src + i)), t));
+        __m128i const p1 = rl2_rgb565Sse2(_mm_adds_epu8(_mm_loadu_si128((__m128i const*)(src + i + 4)), t));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packs_epi32(p0, p1));
+    }
+
+    rl2_rgb565SpanScalar(dst + i, src + i, count - i, dither);
+}
+#endif
+
+#ifdef RL2_SIMD_NEON
+static uint8x8_t rl2_blendArgbNeon(uint8x8_t const s, uint8x8_t const d, uint8x8_t const a) {
+    return rl2_div255Neon(vmlal_u8(vmull_u8(s, a), d, vmvn_u8(a)));
+}
+
+static void rl2_blendArgbSpanNeon(rl2_ARGB8888* const dst, rl2_ARGB8888 const* const src, size_t const count) {
+    uint8x8_t const opaque = vdup_n_u8(255);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        uint8x8x4_t const s = vld4_u8((uint8_t const*)(src + i));
+        uint8x8x4_t d = vld4_u8((uint8_t const*)(dst + i));
+        uint8x8_t const a = s.val[3];
+
+        d.val[0] = rl2_blendArgbNeon(s.val[0], d.val[0], a);
+        d.val[1] = rl2_blendArgbNeon(s.val[1], d.val[1], a);
+        d.val[2] = rl2_blendArgbNeon(s.val[2], d.val[2], a);
+        d.val[3] = rl2_blendArgbNeon(opaque, d.val[3], a);
+        vst4_u8((uint8_t*)(dst + i), d);
+    }
+
+    rl2_blendArgbSpanScalar(dst + i, src + i, count - i);
+}
+
+static void rl2_rgb565SpanNeon(uint16_t* const dst, rl2_ARGB8888 const* const src, size_t const count, uint32_t const dither) {
+    // The four thresholds repeat twice in the eight lanes
+    uint8_t rb[8], g[8];
+
+    for (unsigned j = 0; j < 8; j++) {
+        uint8_t const threshold = (dither >> ((j & 3) * 8)) & 15;
+        rb[j] = threshold / 2;
+        g[j] = threshold / 4;
+    }
+
+    uint8x8_t const t_rb = vld1_u8(rb), t_g = vld1_u8(g);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        uint8x8x4_t const p = vld4_u8((uint8_t const*)(src + i));
+        uint8x8_t const r = vqadd_u8(p.val[0], t_rb);
+        uint8x8_t const gg = vqadd_u8(p.val[1], t_g);
+        uint8x8_t const b = vqadd_u8(p.val[2], t_rb);
+        vst1q_u16(dst + i, rl2_rgb565Neon(r, gg, b));
+    }
+
+    rl2_rgb565SpanScalar(dst + i, src + i, count - i, dither);
+}
+#endif
+
+#ifndef RL2_PIXEL_XRGB8888
+// RGB565 pixels. The vector kernels work on the red and blue channels and on the green channel in separate 16-bit lanes instead
+// of widening to 32 bits like rl2_compose does, but they propagate the carry out of the red/blue lane into green
+// so that the results are bit-identical to the scalar version for all inv_alpha values up to 31.
+
+static rl2_RGB565 rl2_compose(rl2_RGB565 const src, rl2_RGB565 const dst, uint8_t const inv_alpha) {
+    uint32_t const src32 = (src & 0xf81fU) | (uint32_t)(src & 0x07e0U) << 16;
+    uint32_t const dst32 = (dst & 0xf81fU) | (uint32_t)(dst & 0x07e0U) << 16;
+    uint32_t const composed = src32 + (dst32 * inv_alpha) / 32;
+    return (composed & 0xf81fU) | ((composed >> 16) & 0x07e0U);
+}
+
+static void rl2_composeSpanScalar(rl2_RGB565* const dst, rl2_RGB565 const* const src, size_t const count, uint8_t const inv_alpha) {
+    for (size_t i = 0; i < count; i++) {
+        dst[i] = rl2_compose(src[i], dst[i], inv_alpha);
+    }
+}
+
+static void rl2_fillSpanScalar(rl2_RGB565* const dst, size_t const count, rl2_RGB565 const color) {
+    for (size_t i = 0; i < count; i++) {
+        dst[i] = color;
+    }
+}
+
+static void rl2_blendSpanScalar(rl2_RGB565* const dst, size_t const count, rl2_RGB565 const color, uint8_t const inv_alpha) {
+    for (size_t i = 0; i < count; i++) {
+        dst[i] = rl2_compose(color, dst[i], inv_alpha);
+    }
+}
+
+static void rl2_convertSpanScalar(rl2_RGB565* const dst, rl2_ARGB8888 const* const src, size_t const count) {
+    for (size_t i = 0; i < count; i++) {
+        rl2_ARGB8888 const pixel = src[i];
+        dst[i] = RL2_COLOR_RGB565(RL2_ARGB8888_R(pixel), RL2_ARGB8888_G(pixel), RL2_ARGB8888_B(pixel));
+    }
+}
+
+static void rl2_premultiplySpanScalar(
+    rl2_RGB565* const dst, rl2_ARGB8888 const* const src, size_t const count, uint8_t const alpha) {
+
+    for (size_t i = 0; i < count; i++) {
+        rl2_ARGB8888 const pixel = src[i];
+        uint8_t const r = RL2_ARGB8888_R(pixel) * alpha / 255;
+        uint8_t const g = RL2_ARGB8888_G(pixel) * alpha / 255;
+        uint8_t const b = RL2_ARGB8888_B(pixel) * alpha / 255;
+        dst[i] = RL2_COLOR_RGB565(r, g, b);
+    }
+}
+
+static uint32_t rl2_expandRGB565(rl2_RGB565 const pixel, unsigned const r_shift, unsigned const b_shift) {
+    uint32_t const r5 = pixel >> 11, g6 = (pixel >> 5) & 63, b5 = pixel & 31;
+    uint32_t const r8 = r5 << 3 | r5 >> 2, g8 = g6 << 2 | g6 >> 4, b8 = b5 << 3 | b5 >> 2;
+    return UINT32_C(0xff000000) | r8 << r_shift | g8 << 8 | b8 << b_shift;
+}
+
+static void rl2_xrgb8888SpanScalar(uint32_t* const dst, rl2_RGB565 const* const src, size_t const count) {
+    for (size_t i = 0; i < count; i++) {
+        dst[i] = rl2_expandRGB565(src[i], 16, 0);
+    }
+}
+
+static void rl2_abgr8888SpanScalar(uint32_t* const dst, rl2_RGB565 const* const src, size_t const count) {
+    for (size_t i = 0; i < count; i++) {
+        dst[i] = rl2_expandRGB565(src[i], 0, 16);
+    }
+}
+
+static void rl2_rgb555SpanScalar(uint16_t* const dst, rl2_RGB565 const* const src, size_t const count) {
+    for (size_t i = 0; i < count; i++) {
+        dst[i] = ((src[i] >> 1) & 0x7fe0U) | (src[i] & 0x1fU);
+    }
+}
+
+#ifdef RL2_SIMD_X86
+typedef struct {
+    __m128i mask_rb;
+    __m128i mask_g;
+    __m128i mask_g6;
+    __m128i alpha;
+    __m128i alpha_hi;
+}
+rl2_ComposeSse2;
+
+RL2_TARGET_SSE2 static void rl2_initComposeSse2(rl2_ComposeSse2* const k, uint8_t const inv_alpha) {
+    k->mask_rb = _mm_set1_epi16((short)0xf81fU);
+    k->mask_g = _mm_set1_epi16(0x07e0);
+    k->mask_g6 = _mm_set1_epi16(0x003f);
+    k->alpha = _mm_set1_epi16(inv_alpha);
+    k->alpha_hi = _mm_set1_epi16((short)(inv_alpha << 11));
+}
+
+RL2_TARGET_SSE2 static __m128i rl2_composeSse2(rl2_ComposeSse2 const* const k, __m128i const s, __m128i const d) {
+    // (red|blue) * inv_alpha / 32, and the carry out of the 16-bit sum with the source
+    __m128i const s_rb = _mm_and_si128(s, k->mask_rb);
+    __m128i const d_rb = _mm_mulhi_epu16(_mm_and_si128(d, k->mask_rb), k->alpha_hi);
+    __m128i const rb = _mm_add_epi16(s_rb, d_rb);
+    __m128i const carry = _mm_srli_epi16(
+        _mm_or_si128(_mm_and_si128(s_rb, d_rb), _mm_andnot_si128(rb, _mm_or_si128(s_rb, d_rb))), 15);
+
+    // green * inv_alpha, already at the green position
+    __m128i const d_g = _mm_mullo_epi16(_mm_and_si128(_mm_srli_epi16(d, 5), k->mask_g6), k->alpha);
+    __m128i const g = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(s, k->mask_g), d_g), carry);
+
+    return _mm_or_si128(_mm_and_si128(rb, k->mask_rb), _mm_and_si128(g, k->mask_g));
+}
+
+RL2_TARGET_SSE2 static void rl2_composeSpanSse2(
+    rl2_RGB565* const dst, rl2_RGB565 const* const src, size_t const count, uint8_t const inv_alpha) {
+
+    rl2_ComposeSse2 k;
+    rl2_initComposeSse2(&k, inv_alpha);
+
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m128i const s = _mm_loadu_si128((__m128i const*)(src + i));
+        __m128i const d = _mm_loadu_si128((__m128i const*)(dst + i));
+        _mm_storeu_si128((__m128i*)(dst + i), rl2_composeSse2(&k, s, d));
+    }
+
+    rl2_composeSpanScalar(dst + i, src + i, count - i, inv_alpha);
+}
+
+RL2_TARGET_SSE2 static void rl2_fillSpanSse2(rl2_RGB565* const dst, size_t const count, rl2_RGB565 const color) {
+    __m128i const c = _mm_set1_epi16((short)color);
+    size_t i = 0;
+
+    for (; i + 32 <= count; i += 32) {
+        _mm_storeu_si128((__m128i*)(dst + i), c);
+        _mm_storeu_si128((__m128i*)(dst + i + 8), c);
+        _mm_storeu_si128((__m128i*)(dst + i + 16), c);
+        _mm_storeu_si128((__m128i*)(dst + i + 24), c);
+    }
+
+    for (; i + 8 <= count; i += 8) {
+        _mm_storeu_si128((__m128i*)(dst + i), c);
+    }
+
+    rl2_fillSpanScalar(dst + i, count - i, color);
+}
+
+RL2_TARGET_SSE2 static void rl2_blendSpanSse2(
+    rl2_RGB565* const dst, size_t const count, rl2_RGB565 const color, uint8_t const inv_alpha) {
+
+    rl2_ComposeSse2 k;
+    rl2_initComposeSse2(&k, inv_alpha);
+
+    __m128i const s = _mm_set1_epi16((short)color);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m128i const d = _mm_loadu_si128((__m128i const*)(dst + i));
+        _mm_storeu_si128((__m128i*)(dst + i), rl2_composeSse2(&k, s, d));
+    }
+
+    rl2_blendSpanScalar(dst + i, count - i, color, inv_alpha);
+}
+
+RL2_TARGET_SSE2 static void rl2_convertSpanSse2(rl2_RGB565* const dst, rl2_ARGB8888 const* const src, size_t const count) {
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m128i const p0 = rl2_rgb565Sse2(_mm_loadu_si128((__m128i const*)(src + i)));
+        __m128i const p1 = rl2_rgb565Sse2(_mm_loadu_si128((__m128i const*)(src + i + 4)));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packs_epi32(p0, p1));
+    }
+
+    rl2_convertSpanScalar(dst + i, src + i, count - i);
+}
+
+RL2_TARGET_SSE2 static void rl2_premultiplySpanSse2(
+    rl2_RGB565* const dst, rl2_ARGB8888 const* const src, size_t const count, uint8_t const alpha) {
+
+    __m128i const mask = _mm_set1_epi32(0xff);
+    __m128i const a = _mm_set1_epi16(alpha);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m128i const p0 = _mm_loadu_si128((__m128i const*)(src + i));
+        __m128i const p1 = _mm_loadu_si128((__m128i const*)(src + i + 4));
+
+        __m128i const r = _mm_packs_epi32(_mm_and_si128(p0, mask), _mm_and_si128(p1, mask));
+        __m128i const g = _mm_packs_epi32(
+            _mm_and_si128(_mm_srli_epi32(p0, 8), mask), _mm_and_si128(_mm_srli_epi32(p1, 8), mask));
+        __m128i const b = _mm_packs_epi32(
+            _mm_and_si128(_mm_srli_epi32(p0, 16), mask), _mm_and_si128(_mm_srli_epi32(p1, 16), mask));
+
+        __m128i const r8 = rl2_div255Sse2(_mm_mullo_epi16(r, a));
+        __m128i const g8 = rl2_div255Sse2(_mm_mullo_epi16(g, a));
+        __m128i const b8 = rl2_div255Sse2(_mm_mullo_epi16(b, a));
+
+        __m128i const r16 = _mm_slli_epi16(_mm_and_si128(r8, _mm_set1_epi16(0xf8)), 8);
+        __m128i const g16 = _mm_slli_epi16(_mm_and_si128(g8, _mm_set1_epi16(0xfc)), 3);
+        __m128i const rgb = _mm_or_si128(_mm_or_si128(r16, g16), _mm_srli_epi16(b8, 3));
+
+        _mm_storeu_si128((__m128i*)(dst + i), rgb);
+    }
+
+    rl2_premultiplySpanScalar(dst + i, src + i, count - i, alpha);
+}
+
+// Widens the channels of 8 pixels to 8 bits replicating their top bits, and returns the low and high 16-bit halves
+// of the 32-bit pixels, g << 8 | b and 0xff00 | r with b and r swapped for ABGR
+RL2_TARGET_SSE2 static void rl2_expandSse2(__m128i const p, bool const abgr, __m128i* const lo, __m128i* const hi) {
+    __m128i const mask = _mm_set1_epi16(0xff);
+    __m128i const r5 = _mm_srli_epi16(p, 11);
+    __m128i const g6 = _mm_and_si128(_mm_srli_epi16(p, 5), _mm_set1_epi16(63));
+    __m128i const b5 = _mm_and_si128(p, _mm_set1_epi16(31));
+
+    __m128i const r8 = _mm_and_si128(_mm_or_si128(_mm_slli_epi16(r5, 3), _mm_srli_epi16(r5, 2)), mask);
+    __m128i const g8 = _mm_and_si128(_mm_or_si128(_mm_slli_epi16(g6, 2), _mm_srli_epi16(g6, 4)), mask);
+    __m128i const b8 = _mm_and_si128(_mm_or_si128(_mm_slli_epi16(b5, 3), _mm_srli_epi16(b5, 2)), mask);
+
+    __m128i const alpha = _mm_set1_epi16((short)0xff00U);
+    *lo = _mm_or_si128(_mm_slli_epi16(g8, 8), abgr ? r8 : b8);
+    *hi = _mm_or_si128(alpha, abgr ? b8 : r8);
+}
+
+RL2_TARGET_SSE2 static void rl2_expandSpanSse2(
+    uint32_t* const dst, rl2_RGB565 const* const src, size_t const count, bool const abgr) {
+
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m128i lo, hi;
+        rl2_expandSse2(_mm_loadu_si128((__m128i const*)(src + i)), abgr, &lo, &hi);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_unpacklo_epi16(lo, hi));
+        _mm_storeu_si128((__m128i*)(dst + i + 4), _mm_unpackhi_epi16(lo, hi));
+    }
+
+    if (abgr) {
+        rl2_abgr8888SpanScalar(dst + i, src + i, count - i);
+    }
+    else {
+        rl2_xrgb8888SpanScalar(dst + i, src + i, count - i);
+    }
+}
+
+RL2_TARGET_SSE2 static void rl2_xrgb8888SpanSse2(uint32_t* const dst, rl2_RGB565 const* const src, size_t const count) {
+    rl2_expandSpanSse2(dst, src, count, false);
+}
+
+RL2_TARGET_SSE2 static void rl2_abgr8888SpanSse2(uint32_t* const dst, rl2_RGB565 const* const src, size_t const count) {
+    rl2_expandSpanSse2(dst, src, count, true);
+}
+
+RL2_TARGET_SSE2 static void rl2_rgb555SpanSse2(uint16_t* const dst, rl2_RGB565 const* const src, size_t const count) {
+    __m128i const mask_rg = _mm_set1_epi16(0x7fe0);
+    __m128i const mask_b = _mm_set1_epi16(0x1f);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m128i const p = _mm_loadu_si128((__m128i const*)(src + i));
+        __m128i const rgb = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(p, 1), mask_rg), _mm_and_si128(p, mask_b));
+        _mm_storeu_si128((__m128i*)(dst + i), rgb);
+    }
+
+    rl2_rgb555SpanScalar(dst + i, src + i, count - i);
+}
+
+typedef struct {
+    __m256i mask_rb;
+    __m256i mask_g;
+    __m256i mask_g6;
+    __m256i alpha;
+    __m256i alpha_hi;
+}
+rl2_ComposeAvx2;
+
+RL2_TARGET_AVX2 static void rl2_initComposeAvx2(rl2_ComposeAvx2* const k, uint8_t const inv_alpha) {
+    k->mask_rb = _mm256_set1_epi16((short)0xf81fU);
+    k->mask_g = _mm256_set1_epi16(0x07e0);
+    k->mask_g6 = _mm256_set1_epi16(0x003f);
+    k->alpha = _mm256_set1_epi16(inv_alpha);
+    k->alpha_hi = _mm256_set1_epi16((short)(inv_alpha << 11));
+}
+
+RL2_TARGET_AVX2 static __m256i rl2_composeAvx2(rl2_ComposeAvx2 const* const k, __m256i const s, __m256i const d) {
+    __m256i const s_rb = _mm256_and_si256(s, k->mask_rb);
+    __m256i const d_rb = _mm256_mulhi_epu16(_mm256_and_si256(d, k->mask_rb), k->alpha_hi);
+    __m256i const rb = _mm256_add_epi16(s_rb, d_rb);
+    __m256i const carry = _mm256_srli_epi16(
+        _mm256_or_si256(_mm256_and_si256(s_rb, d_rb), _mm256_andnot_si256(rb, _mm256_or_si256(s_rb, d_rb))), 15);
+
+    __m256i const d_g = _mm256_mullo_epi16(_mm256_and_si256(_mm256_srli_epi16(d, 5), k->mask_g6), k->alpha);
+    __m256i const g = _mm256_add_epi16(_mm256_add_epi16(_mm256_and_si256(s, k->mask_g), d_g), carry);
+
+    return _mm256_or_si256(_mm256_and_si256(rb, k->mask_rb), _mm256_and_si256(g, k->mask_g));
+}
+
+RL2_TARGET_AVX2 static void rl2_composeSpanAvx2(
+    rl2_RGB565* const dst, rl2_RGB565 const* const src, size_t const count, uint8_t const inv_alpha) {
+
+    rl2_ComposeAvx2 k;
+    rl2_initComposeAvx2(&k, inv_alpha);
+
+    size_t i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        __m256i const s = _mm256_loadu_si256((__m256i const*)(src + i));
+        __m256i const d = _mm256_loadu_si256((__m256i const*)(dst + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), rl2_composeAvx2(&k, s, d));
+    }
+
+    rl2_composeSpanSse2(dst + i, src + i, count - i, inv_alpha);
+}
+
+RL2_TARGET_AVX2 static void rl2_fillSpanAvx2(rl2_RGB565* const dst, size_t const count, rl2_RGB565 const color) {
+    __m256i const c = _mm256_set1_epi16((short)color);
+    size_t i = 0;
+
+    for (; i + 64 <= count; i += 64) {
+        _mm256_storeu_si256((__m256i*)(dst + i), c);
+        _mm256_storeu_si256((__m256i*)(dst + i + 16), c);
+        _mm256_storeu_si256((__m256i*)(dst + i + 32), c);
+        _mm256_storeu_si256((__m256i*)(dst + i + 48), c);
+    }
+
+    for (; i + 16 <= count; i += 16) {
+        _mm256_storeu_si256((__m256i*)(dst + i), c);
+    }
+
+    rl2_fillSpanSse2(dst + i, count - i, color);
+}
+
+RL2_TARGET_AVX2 static void rl2_blendSpanAvx2(
+    rl2_RGB565* const dst, size_t const count, rl2_RGB565 const color, uint8_t const inv_alpha) {
+
+    rl2_ComposeAvx2 k;
+    rl2_initComposeAvx2(&k, inv_alpha);
+
+    __m256i const s = _mm256_set1_epi16((short)color);
+    size_t i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        __m256i const d = _mm256_loadu_si256((__m256i const*)(dst + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), rl2_composeAvx2(&k, s, d));
+    }
+
+    rl2_blendSpanSse2(dst + i, count - i, color, inv_alpha);
+}
+#endif
+
+#ifdef RL2_SIMD_NEON
+static uint16x8_t rl2_composeNeon(uint16x8_t const s, uint16x8_t const d, uint8_t const inv_alpha) {
+    uint16x8_t const mask_rb = vdupq_n_u16(0xf81fU);
+    uint16x8_t const mask_g = vdupq_n_u16(0x07e0U);
+    uint16x8_t const mask_g6 = vdupq_n_u16(0x003fU);
+    uint16x4_t const alpha = vdup_n_u16(inv_alpha);
+
+    uint16x8_t const s_rb = vandq_u16(s, mask_rb);
+    uint16x8_t const d_rb = vandq_u16(d, mask_rb);
+    uint16x8_t const d_rb_alpha = vcombine_u16(
+        vshrn_n_u32(vmull_u16(vget_low_u16(d_rb), alpha), 5),
+        vshrn_n_u32(vmull_u16(vget_high_u16(d_rb), alpha), 5)
+    );
+
+    uint16x8_t const rb = vaddq_u16(s_rb, d_rb_alpha);
+    uint16x8_t const carry = vshrq_n_u16(vcltq_u16(rb, s_rb), 15);
+
+    uint16x8_t const d_g = vandq_u16(vshrq_n_u16(d, 5), mask_g6);
+    uint16x8_t const g = vaddq_u16(vmlaq_n_u16(vandq_u16(s, mask_g), d_g, inv_alpha), carry);
+
+    return vorrq_u16(vandq_u16(rb, mask_rb), vandq_u16(g, mask_g));
+}
+
+static void rl2_composeSpanNeon(rl2_RGB565* const dst, rl2_RGB565 const* const src, size_t const count, uint8_t const inv_alpha) {
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        vst1q_u16(dst + i, rl2_composeNeon(vld1q_u16(src + i), vld1q_u16(dst + i), inv_alpha));
+    }
+
+    rl2_composeSpanScalar(dst + i, src + i, count - i, inv_alpha);
+}
+
+static void rl2_fillSpanNeon(rl2_RGB565* const dst, size_t const count, rl2_RGB565 const color) {
+    uint16x8_t const c = vdupq_n_u16(color);
+    size_t i = 0;
+
+    for (; i + 32 <= count; i += 32) {
+        vst1q_u16(dst + i, c);
+        vst1q_u16(dst + i + 8, c);
+        vst1q_u16(dst + i + 16, c);
+        vst1q_u16(dst + i + 24, c);
+    }
+
+    for (; i + 8 <= count; i += 8) {
+        vst1q_u16(dst + i, c);
+    }
+
+    rl2_fillSpanScalar(dst + i, count - i, color);
+}
+
+static void rl2_blendSpanNeon(rl2_RGB565* const dst, size_t const count, rl2_RGB565 const color, uint8_t const inv_alpha) {
+    uint16x8_t const s = vdupq_n_u16(color);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        vst1q_u16(dst + i, rl2_composeNeon(s, vld1q_u16(dst + i), inv_alpha));
+    }
+
+    rl2_blendSpanScalar(dst + i, count - i, color, inv_alpha);
+}
+
+static void rl2_convertSpanNeon(rl2_RGB565* const dst, rl2_ARGB8888 const* const src, size_t const count) {
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        uint8x8x4_t const p = vld4_u8((uint8_t const*)(src + i));
+        vst1q_u16(dst + i, rl2_rgb565Neon(p.val[0], p.val[1], p.val[2]));
+    }
+
+    rl2_convertSpanScalar(dst + i, src + i, count - i);
+}
+
+static void rl2_premultiplySpanNeon(
+    rl2_RGB565* const dst, rl2_ARGB8888 const* const src, size_t const count, uint8_t const alpha) {
+
+    uint8x8_t const a = vdup_n_u8(alpha);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        uint8x8x4_t const p = vld4_u8((uint8_t const*)(src + i));
+
+        uint8x8_t const r = rl2_div255Neon(vmull_u8(p.val[0], a));
+        uint8x8_t const g = rl2_div255Neon(vmull_u8(p.val[1], a));
+        uint8x8_t const b = rl2_div255Neon(vmull_u8(p.val[2], a));
+
+        vst1q_u16(dst + i, rl2_rgb565Neon(r, g, b));
+    }
+
+    rl2_premultiplySpanScalar(dst + i, src + i, count - i, alpha);
+}
+static void rl2_expandSpanNeon(uint32_t* const dst, rl2_RGB565 const* const src, size_t const count, bool const abgr) {
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        uint16x8_t const p = vld1q_u16(src + i);
+
+        uint8x8_t const r = vand_u8(vshrn_n_u16(p, 8), vdup_n_u8(0xf8));
+        uint8x8_t const g = vand_u8(vshrn_n_u16(p, 3), vdup_n_u8(0xfc));
+        uint8x8_t const b = vmovn_u16(vshlq_n_u16(p, 3));
+
+        // Bytes in memory order, b g r a for XRGB and r g b a for ABGR on little-endian
+        uint8x8x4_t q;
+        q.val[abgr ? 2 : 0] = vorr_u8(b, vshr_n_u8(b, 5));
+        q.val[1] = vorr_u8(g, vshr_n_u8(g, 6));
+        q.val[abgr ? 0 : 2] = vorr_u8(r, vshr_n_u8(r, 5));
+        q.val[3] = vdup_n_u8(0xff);
+        vst4_u8((uint8_t*)(dst + i), q);
+    }
+
+    if (abgr) {
+        rl2_abgr8888SpanScalar(dst + i, src + i, count - i);
+    }
+    else {
+        rl2_xrgb8888SpanScalar(dst + i, src + i, count - i);
+    }
+}
+
+static void rl2_xrgb8888SpanNeon(uint32_t* const dst, rl2_RGB565 const* const src, size_t const count) {
+    rl2_expandSpanNeon(dst, src, count, false);
+}
+
+static void rl2_abgr8888SpanNeon(uint32_t* const dst, rl2_RGB565 const* const src, size_t const count) {
+    rl2_expandSpanNeon(dst, src, count, true);
+}
+
+static void rl2_rgb555SpanNeon(uint16_t* const dst, rl2_RGB565 const* const src, size_t const count) {
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        uint16x8_t const p = vld1q_u16(src + i);
+        // Red and green shifted down one bit, blue as is
+        vst1q_u16(dst + i, vbslq_u16(vdupq_n_u16(0x001fU), p, vshrq_n_u16(p, 1)));
+    }
+
+    rl2_rgb555SpanScalar(dst + i, src + i, count - i);
+}
+#endif
+
+#else
+// XRGB8888 pixels are composed one 8-bit channel at a time with unsigned saturation, premultiplied colors can go
+// slightly over 255 because of the alpha quantization; the alpha channel is always saturated back to 255
+
+static rl2_Pixel rl2_compose(rl2_Pixel const src, rl2_Pixel const dst, uint8_t const inv_alpha) {
+    rl2_Pixel composed = 0;
+
+    for (unsigned shift = 0; shift < 32; shift += 8) {
+        uint32_t const c = ((src >> shift) & 255) + ((((dst >> shift) & 255) * inv_alpha) >> 5);
+        composed |= (c < 255 ? c : 255) << shift;
+    }
+
+    return composed;
+}
+
+static void rl2_composeSpanScalar(rl2_Pixel* const dst, rl2_Pixel const* const src, size_t const count, uint8_t const inv_alpha) {
+    for (size_t i = 0; i < count; i++) {
+        dst[i] = rl2_compose(src[i], dst[i], inv_alpha);
+    }
+}
+
+static void rl2_fillSpanScalar(rl2_Pixel* const dst, size_t const count, rl2_Pixel const color) {
+    for (size_t i = 0; i < count; i++) {
+        dst[i] = color;
+    }
+}
+
+static void rl2_blendSpanScalar(rl2_Pixel* const dst, size_t const count, rl2_Pixel const color, uint8_t const inv_alpha) {
+    for (size_t i = 0; i < count; i++) {
+        dst[i] = rl2_compose(color, dst[i], inv_alpha);
+    }
+}
+
+static void rl2_convertSpanScalar(rl2_Pixel* const dst, rl2_ARGB8888 const* const src, size_t const count) {
+    for (size_t i = 0; i < count; i++) {
+        rl2_ARGB8888 const pixel = src[i];
+        dst[i] = RL2_COLOR(RL2_ARGB8888_R(pixel), RL2_ARGB8888_G(pixel), RL2_ARGB8888_B(pixel));
+    }
+}
+
+static void rl2_premultiplySpanScalar(
+    rl2_Pixel* const dst, rl2_ARGB8888 const* const src, size_t const count, uint8_t const alpha) {
+
+    for (size_t i = 0; i < count; i++) {
+        rl2_ARGB8888 const pixel = src[i];
+        uint8_t const r = RL2_ARGB8888_R(pixel) * alpha / 255;
+        uint8_t const g = RL2_ARGB8888_G(pixel) * alpha / 255;
+        uint8_t const b = RL2_ARGB8888_B(pixel) * alpha / 255;
+        dst[i] = RL2_COLOR(r, g, b);
+    }
+}
+
+static void rl2_xrgb8888SpanScalar(uint32_t* const dst, rl2_Pixel const* const src, size_t const count) {
+    for (size_t i = 0; i < count; i++) {
+        dst[i] = src[i] | UINT32_C(0xff000000);
+    }
+}
+
+static void rl2_abgr8888SpanScalar(uint32_t* const dst, rl2_Pixel const* const src, size_t const count) {
+    for (size_t i = 0; i < count; i++) {
+        rl2_Pixel const p = src[i];
+        dst[i] = UINT32_C(0xff000000) | (p & 0xff00U) | (p & 0xffU) << 16 | ((p >> 16) & 0xffU);
+    }
+}
+
+static void rl2_rgb555SpanScalar(uint16_t* const dst, rl2_Pixel const* const src, size_t const count) {
+    for (size_t i = 0; i < count; i++) {
+        rl2_Pixel const p = src[i];
+        dst[i] = ((p >> 9) & 0x7c00U) | ((p >> 6) & 0x03e0U) | ((p >> 3) & 0x001fU);
+    }
+}
+
+#ifdef RL2_SIMD_X86
+RL2_TARGET_SSE2 static __m128i rl2_composeSse2(__m128i const s, __m128i const d, __m128i const alpha) {
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), alpha), 5);
+    __m128i const hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), alpha), 5);
+    return _mm_adds_epu8(s, _mm_packus_epi16(lo, hi));
+}
+
+RL2_TARGET_SSE2 static void rl2_composeSpanSse2(
+    rl2_Pixel* const dst, rl2_Pixel const* const src, size_t const count, uint8_t const inv_alpha) {
+
+    __m128i const alpha = _mm_set1_epi16(inv_alpha);
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m128i const s = _mm_loadu_si128((__m128i const*)(src + i));
+        __m128i const d = _mm_loadu_si128((__m128i const*)(dst + i));
+        _mm_storeu_si128((__m128i*)(dst + i), rl2_composeSse2(s, d, alpha));
+    }
+
+    rl2_composeSpanScalar(dst + i, src + i, count - i, inv_alpha);
+}
+
+RL2_TARGET_SSE2 static void rl2_fillSpanSse2(rl2_Pixel* const dst, size_t const count, rl2_Pixel const color) {
+    __m128i const c = _mm_set1_epi32((int)color);
+    size_t i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        _mm_storeu_si128((__m128i*)(dst + i), c);
+        _mm_storeu_si128((__m128i*)(dst + i + 4), c);
+        _mm_storeu_si128((__m128i*)(dst + i + 8), c);
+        _mm_storeu_si128((__m128i*)(dst + i + 12), c);
+    }
+
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_si128((__m128i*)(dst + i), c);
+    }
+
+    rl2_fillSpanScalar(dst + i, count - i, color);
+}
+
+RL2_TARGET_SSE2 static void rl2_blendSpanSse2(
+    rl2_Pixel* const dst, size_t const count, rl2_Pixel const color, uint8_t const inv_alpha) {
+
+    __m128i const alpha = _mm_set1_epi16(inv_alpha);
+    __m128i const s = _mm_set1_epi32((int)color);
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m128i const d = _mm_loadu_si128((__m128i const*)(dst + i));
+        _mm_storeu_si128((__m128i*)(dst + i), rl2_composeSse2(s, d, alpha));
+    }
+
+    rl2_blendSpanScalar(dst + i, count - i, color, inv_alpha);
+}
+
+RL2_TARGET_SSE2 static __m128i rl2_swapRedBlueSse2(__m128i const p) {
+    // R and B trade places, alpha is forced to 255
+    __m128i const ag = _mm_or_si128(_mm_and_si128(p, _mm_set1_epi32(0xff00)), _mm_set1_epi32((int)0xff000000U));
+    __m128i const rb = _mm_and_si128(_mm_or_si128(_mm_slli_epi32(p, 16), _mm_srli_epi32(p, 16)), _mm_set1_epi32(0xff00ff));
+    return _mm_or_si128(ag, rb);
+}
+
+RL2_TARGET_SSE2 static void rl2_convertSpanSse2(rl2_Pixel* const dst, rl2_ARGB8888 const* const src, size_t const count) {
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m128i const p = _mm_loadu_si128((__m128i const*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + i), rl2_swapRedBlueSse2(p));
+    }
+
+    rl2_convertSpanScalar(dst + i, src + i, count - i);
+}
+
+RL2_TARGET_SSE2 static void rl2_premultiplySpanSse2(
+    rl2_Pixel* const dst, rl2_ARGB8888 const* const src, size_t const count, uint8_t const alpha) {
+
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const a = _mm_set1_epi16(alpha);
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m128i const p = _mm_loadu_si128((__m128i const*)(src + i));
+        __m128i const lo = rl2_div255Sse2(_mm_mullo_epi16(_mm_unpacklo_epi8(p, zero), a));
+        __m128i const hi = rl2_div255Sse2(_mm_mullo_epi16(_mm_unpackhi_epi8(p, zero), a));
+        _mm_storeu_si128((__m128i*)(dst + i), rl2_swapRedBlueSse2(_mm_packus_epi16(lo, hi)));
+    }
+
+    rl2_premultiplySpanScalar(dst + i, src + i, count - i, alpha);
+}
+
+RL2_TARGET_SSE2 static void rl2_xrgb8888SpanSse2(uint32_t* const dst, rl2_Pixel const* const src, size_t const count) {
+    __m128i const alpha = _mm_set1_epi32((int)0xff000000U);
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m128i const p = _mm_loadu_si128((__m128i const*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(p, alpha));
+    }
+
+    rl2_xrgb8888SpanScalar(dst + i, src + i, count - i);
+}
+
+RL2_TARGET_SSE2 static void rl2_abgr8888SpanSse2(uint32_t* const dst, rl2_Pixel const* const src, size_t const count) {
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m128i const p = _mm_loadu_si128((__m128i const*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + i), rl2_swapRedBlueSse2(p));
+    }
+
+    rl2_abgr8888SpanScalar(dst + i, src + i, count - i);
+}
+
+RL2_TARGET_SSE2 static __m128i rl2_rgb555Sse2(__m128i const p) {
+    __m128i const r = _mm_and_si128(_mm_srli_epi32(p, 9), _mm_set1_epi32(0x7c00));
+    __m128i const g = _mm_and_si128(_mm_srli_epi32(p, 6), _mm_set1_epi32(0x03e0));
+    __m128i const b = _mm_and_si128(_mm_srli_epi32(p, 3), _mm_set1_epi32(0x001f));
+    return _mm_or_si128(_mm_or_si128(r, g), b);
+}
+
+RL2_TARGET_SSE2 static void rl2_rgb555SpanSse2(uint16_t* const dst, rl2_Pixel const* const src, size_t const count) {
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        // Colors have 15 bits, _mm_packs_epi32 never saturates them
+        __m128i const p0 = rl2_rgb555Sse2(_mm_loadu_si128((__m128i const*)(src + i)));
+        __m128i const p1 = rl2_rgb555Sse2(_mm_loadu_si128((__m128i const*)(src + i + 4)));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packs_epi32(p0, p1));
+    }
+
+    rl2_rgb555SpanScalar(dst + i, src + i, count - i);
+}
+
+RL2_TARGET_AVX2 static __m256i rl2_composeAvx2(__m256i const s, __m256i const d, __m256i const alpha) {
+    // Unpacking and packing work within each 128-bit lane, so the pixels end up where they started
+    __m256i const zero = _mm256_setzero_si256();
+    __m256i const lo = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), alpha), 5);
+    __m256i const hi = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), alpha), 5);
+    return _mm256_adds_epu8(s, _mm256_packus_epi16(lo, hi));
+}
+
+RL2_TARGET_AVX2 static void rl2_composeSpanAvx2(
+    rl2_Pixel* const dst, rl2_Pixel const* const src, size_t const count, uint8_t const inv_alpha) {
+
+    __m256i const alpha = _mm256_set1_epi16(inv_alpha);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m256i const s = _mm256_loadu_si256((__m256i const*)(src + i));
+        __m256i const d = _mm256_loadu_si256((__m256i const*)(dst + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), rl2_composeAvx2(s, d, alpha));
+    }
+
+    rl2_composeSpanSse2(dst + i, src + i, count - i, inv_alpha);
+}
+
+RL2_TARGET_AVX2 static void rl2_fillSpanAvx2(rl2_Pixel* const dst, size_t const count, rl2_Pixel const color) {
+    __m256i const c = _mm256_set1_epi32((int)color);
+    size_t i = 0;
+
+    for (; i + 32 <= count; i += 32) {
+        _mm256_storeu_si256((__m256i*)(dst + i), c);
+        _mm256_storeu_si256((__m256i*)(dst + i + 8), c);
+        _mm256_storeu_si256((__m256i*)(dst + i + 16), c);
+        _mm256_storeu_si256((__m256i*)(dst + i + 24), c);
+    }
+
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_si256((__m256i*)(dst + i), c);
+    }
+
+    rl2_fillSpanSse2(dst + i, count - i, color);
+}
+
+RL2_TARGET_AVX2 static void rl2_blendSpanAvx2(
+    rl2_Pixel* const dst, size_t const count, rl2_Pixel const color, uint8_t const inv_alpha) {
+
+    __m256i const alpha = _mm256_set1_epi16(inv_alpha);
+    __m256i const s = _mm256_set1_epi32((int)color);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m256i const d = _mm256_loadu_si256((__m256i const*)(dst + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), rl2_composeAvx2(s, d, alpha));
+    }
+
+    rl2_blendSpanSse2(dst + i, count - i, color, inv_alpha);
+}
+#endif
+
+#ifdef RL2_SIMD_NEON
+static uint8x16_t rl2_composeNeon(uint8x16_t const s, uint8x16_t const d, uint8_t const inv_alpha) {
+    uint8x8_t const alpha = vdup_n_u8(inv_alpha);
+    uint8x8_t const lo = vshrn_n_u16(vmull_u8(vget_low_u8(d), alpha), 5);
+    uint8x8_t const hi = vshrn_n_u16(vmull_u8(vget_high_u8(d), alpha), 5);
+    return vqaddq_u8(s, vcombine_u8(lo, hi));
+}
+
+static void rl2_composeSpanNeon(rl2_Pixel* const dst, rl2_Pixel const* const src, size_t const count, uint8_t const inv_alpha) {
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        uint8x16_t const s = vld1q_u8((uint8_t const*)(src + i));
+        uint8x16_t const d = vld1q_u8((uint8_t const*)(dst + i));
+        vst1q_u8((uint8_t*)(dst + i), rl2_composeNeon(s, d, inv_alpha));
+    }
+
+    rl2_composeSpanScalar(dst + i, src + i, count - i, inv_alpha);
+}
+
+static void rl2_fillSpanNeon(rl2_Pixel* const dst, size_t const count, rl2_Pixel const color) {
+    uint32x4_t const c = vdupq_n_u32(color);
+    size_t i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        vst1q_u32(dst + i, c);
+        vst1q_u32(dst + i + 4, c);
+        vst1q_u32(dst + i + 8, c);
+        vst1q_u32(dst + i + 12, c);
+    }
+
+    for (; i + 4 <= count; i += 4) {
+        vst1q_u32(dst + i, c);
+    }
+
+    rl2_fillSpanScalar(dst + i, count - i, color);
+}
+
+static void rl2_blendSpanNeon(rl2_Pixel* const dst, size_t const count, rl2_Pixel const color, uint8_t const inv_alpha) {
+    uint8x16_t const s = vreinterpretq_u8_u32(vdupq_n_u32(color));
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        uint8x16_t const d = vld1q_u8((uint8_t const*)(dst + i));
+        vst1q_u8((uint8_t*)(dst + i), rl2_composeNeon(s, d, inv_alpha));
+    }
+
+    rl2_blendSpanScalar(dst + i, count - i, color, inv_alpha);
+}
+
+static void rl2_storeXrgbNeon(rl2_Pixel* const dst, uint8x8_t const r, uint8x8_t const g, uint8x8_t const b) {
+    // Bytes in memory order on little-endian
+    uint8x8x4_t p;
+    p.val[0] = b;
+    p.val[1] = g;
+    p.val[2] = r;
+    p.val[3] = vdup_n_u8(255);
+    vst4_u8((uint8_t*)dst, p);
+}
+
+static void rl2_convertSpanNeon(rl2_Pixel* const dst, rl2_ARGB8888 const* const src, size_t const count) {
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        uint8x8x4_t const p = vld4_u8((uint8_t const*)(src + i));
+        rl2_storeXrgbNeon(dst + i, p.val[0], p.val[1], p.val[2]);
+    }
+
+    rl2_convertSpanScalar(dst + i, src + i, count - i);
+}
+
+static void rl2_premultiplySpanNeon(
+    rl2_Pixel* const dst, rl2_ARGB8888 const* const src, size_t const count, uint8_t const alpha) {
+
+    uint8x8_t const a = vdup_n_u8(alpha);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        uint8x8x4_t const p = vld4_u8((uint8_t const*)(src + i));
+
+        uint8x8_t const r = rl2_div255Neon(vmull_u8(p.val[0], a));
+        uint8x8_t const g = rl2_div255Neon(vmull_u8(p.val[1], a));
+        uint8x8_t const b = rl2_div255Neon(vmull_u8(p.val[2], a));
+
+        rl2_storeXrgbNeon(dst + i, r, g, b);
+    }
+
+    rl2_premultiplySpanScalar(dst + i, src + i, count - i, alpha);
+}
+
+static void rl2_xrgb8888SpanNeon(uint32_t* const dst, rl2_Pixel const* const src, size_t const count) {
+    uint32x4_t const alpha = vdupq_n_u32(0xff000000U);
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        vst1q_u32(dst + i, vorrq_u32(vld1q_u32(src + i), alpha));
+    }
+
+    rl2_xrgb8888SpanScalar(dst + i, src + i, count - i);
+}
+
+static void rl2_abgr8888SpanNeon(uint32_t* const dst, rl2_Pixel const* const src, size_t const count) {
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        uint8x8x4_t p = vld4_u8((uint8_t const*)(src + i));
+        uint8x8_t const b = p.val[0];
+        p.val[0] = p.val[2];
+        p.val[2] = b;
+        p.val[3] = vdup_n_u8(255);
+        vst4_u8((uint8_t*)(dst + i), p);
+    }
+
+    rl2_abgr8888SpanScalar(dst + i, src + i, count - i);
+}
+
+static void rl2_rgb555SpanNeon(uint16_t* const dst, rl2_Pixel const* const src, size_t const count) {
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        uint8x8x4_t const p = vld4_u8((uint8_t const*)(src + i));
+        uint16x8_t rgb = vshll_n_u8(p.val[2], 7);
+        rgb = vsriq_n_u16(rgb, vshll_n_u8(p.val[1], 8), 6);
+        vst1q_u16(dst + i, vsriq_n_u16(rgb, vshll_n_u8(p.val[0], 8), 11));
+    }
+
+    rl2_rgb555SpanScalar(dst + i, src + i, count - i);
+}
+#endif
+#endif // RL2_PIXEL_XRGB8888
+
+typedef void (*rl2_ComposeSpanFunc)(rl2_Pixel* const, rl2_Pixel const* const, size_t const, uint8_t const);
+typedef void (*rl2_FillSpanFunc)(rl2_Pixel* const, size_t const, rl2_Pixel const);
+typedef void (*rl2_BlendSpanFunc)(rl2_Pixel* const, size_t const, rl2_Pixel const, uint8_t const);
+typedef void (*rl2_AlphaLevelsFunc)(uint8_t* const, rl2_ARGB8888 const* const, size_t const);
+typedef void (*rl2_ConvertSpanFunc)(rl2_Pixel* const, rl2_ARGB8888 const* const, size_t const);
+typedef void (*rl2_PremultiplySpanFunc)(rl2_Pixel* const, rl2_ARGB8888 const* const, size_t const, uint8_t const);
+typedef void (*rl2_Expand32SpanFunc)(uint32_t* const, rl2_Pixel const* const, size_t const);
+typedef void (*rl2_Rgb555SpanFunc)(uint16_t* const, rl2_Pixel const* const, size_t const);
+typedef void (*rl2_ReverseSpanFunc)(rl2_ARGB8888* const, rl2_ARGB8888 const* const, size_t const);
+typedef void (*rl2_TransposeBlockFunc)(
+    rl2_ARGB8888* const, ptrdiff_t const, rl2_ARGB8888 const* const, ptrdiff_t const, unsigned const, unsigned const);
+typedef void (*rl2_BlendArgbSpanFunc)(rl2_ARGB8888* const, rl2_ARGB8888 const* const, size_t const);
+typedef void (*rl2_Rgb565SpanFunc)(uint16_t* const, rl2_ARGB8888 const* const, size_t const, uint32_t const);
+
+static struct {
+    rl2_ComposeSpanFunc compose;
+    rl2_FillSpanFunc fill;
+    rl2_BlendSpanFunc blend;
+    rl2_AlphaLevelsFunc alpha_levels;
+    rl2_ConvertSpanFunc convert;
+    rl2_PremultiplySpanFunc premultiply;
+    rl2_Expand32SpanFunc xrgb8888;
+    rl2_Expand32SpanFunc abgr8888;
+    rl2_Rgb555SpanFunc rgb555;
+    rl2_ReverseSpanFunc reverse;
+    rl2_TransposeBlockFunc transpose;
+    rl2_BlendArgbSpanFunc blend_argb;
+    rl2_Rgb565SpanFunc rgb565;
+}
+rl2_kernels = {NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL};
+
+static rl2_Once rl2_kernelsOnce = RL2_ONCE_INIT;
+
+static void rl2_initKernels(void) {
+    rl2_kernels.compose = rl2_composeSpanScalar;
+    rl2_kernels.fill = rl2_fillSpanScalar;
+    rl2_kernels.blend = rl2_blendSpanScalar;
+    rl2_kernels.alpha_levels = rl2_alphaLevelsScalar;
+    rl2_kernels.convert = rl2_convertSpanScalar;
+    rl2_kernels.premultiply = rl2_premultiplySpanScalar;
+    rl2_kernels.xrgb8888 = rl2_xrgb8888SpanScalar;
+    rl2_kernels.abgr8888 = rl2_abgr8888SpanScalar;
+    rl2_kernels.rgb555 = rl2_rgb555SpanScalar;
+    rl2_kernels.reverse = rl2_reverseSpanScalar;
+    rl2_kernels.transpose = rl2_transposeBlockScalar;
+    rl2_kernels.blend_argb = rl2_blendArgbSpanScalar;
+    rl2_kernels.rgb565 = rl2_rgb565SpanScalar;
+
+#if defined(RL2_SIMD_X86)
+    unsigned const features = rl2_cpuFeatures();
+
+    if ((features & RL2_CPU_SSE2) != 0) {
+        // The conversions are bound by memory bandwidth, there are no AVX2 versions
+        rl2_kernels.alpha_levels = rl2_alphaLevelsSse2;
+        rl2_kernels.convert = rl2_convertSpanSse2;
+        rl2_kernels.premultiply = rl2_premultiplySpanSse2;
+        rl2_kernels.xrgb8888 = rl2_xrgb8888SpanSse2;
+        rl2_kernels.abgr8888 = rl2_abgr8888SpanSse2;
+        rl2_kernels.rgb555 = rl2_rgb555SpanSse2;
+        rl2_kernels.reverse = rl2_reverseSpanSse2;
+        rl2_kernels.transpose = rl2_transposeBlockSse2;
+        rl2_kernels.blend_argb = rl2_blendArgbSpanSse2;
+        rl2_kernels.rgb565 = rl2_rgb565SpanSse2;
+    }
+
+    if ((features & RL2_CPU_AVX2) != 0) {
+        rl2_kernels.compose = rl2_composeSpanAvx2;
+        rl2_kernels.fill = rl2_fillSpanAvx2;
+        rl2_kernels.blend = rl2_blendSpanAvx2;
+    }
+    else if ((features & RL2_CPU_SSE2) != 0) {
+        rl2_kernels.compose = rl2_composeSpanSse2;
+        rl2_kernels.fill = rl2_fillSpanSse2;
+        rl2_kernels.blend = rl2_blendSpanSse2;
+    }
+#elif defined(RL2_SIMD_NEON)
+    rl2_kernels.compose = rl2_composeSpanNeon;
+    rl2_kernels.fill = rl2_fillSpanNeon;
+    rl2_kernels.blend = rl2_blendSpanNeon;
+    rl2_kernels.alpha_levels = rl2_alphaLevelsNeon;
+    rl2_kernels.convert = rl2_convertSpanNeon;
+    rl2_kernels.premultiply = rl2_premultiplySpanNeon;
+    rl2_kernels.xrgb8888 = rl2_xrgb8888SpanNeon;
+    rl2_kernels.abgr8888 = rl2_abgr8888SpanNeon;
+    rl2_kernels.rgb555 = rl2_rgb555SpanNeon;
+    rl2_kernels.reverse = rl2_reverseSpanNeon;
+    rl2_kernels.transpose = rl2_transposeBlockNeon;
+    rl2_kernels.blend_argb = rl2_blendArgbSpanNeon;
+    rl2_kernels.rgb565 = rl2_rgb565SpanNeon;
+#endif
+}
+
+void rl2_selectKernels(void) {
+    rl2_callOnce(&rl2_kernelsOnce, rl2_initKernels);
+}
+
+void rl2_composeSpan(rl2_Pixel* const dst, rl2_Pixel const* const src, size_t const count, uint8_t const inv_alpha) {
+    if (inv_alpha >= 32) {
+        // Out of the range the vector kernels are exact for, never generated by the RLE encoder
+        rl2_composeSpanScalar(dst, src, count, inv_alpha);
+        return;
+    }
+
+    rl2_selectKernels();
+
+    rl2_kernels.compose(dst, src, count, inv_alpha);
+}
+
+void rl2_fillSpan(rl2_Pixel* const dst, size_t const count, rl2_Pixel const color) {
+    rl2_selectKernels();
+
+    rl2_kernels.fill(dst, count, color);
+}
+
+void rl2_blendSpan(rl2_Pixel* const dst, size_t const count, rl2_Pixel const color, uint8_t const inv_alpha) {
+    if (inv_alpha >= 32) {
+        rl2_blendSpanScalar(dst, count, color, inv_alpha);
+        return;
+    }
+
+    rl2_selectKernels();
+
+    rl2_kernels.blend(dst, count, color, inv_alpha);
+}
+
+void rl2_alphaLevels(uint8_t* const levels, rl2_ARGB8888 const* const src, size_t const count) {
+    rl2_selectKernels();
+
+    rl2_kernels.alpha_levels(levels, src, count);
+}
+
+void rl2_convertSpan(rl2_Pixel* const dst, rl2_ARGB8888 const* const src, size_t const count) {
+    rl2_selectKernels();
+
+    rl2_kernels.convert(dst, src, count);
+}
+
+void rl2_premultiplySpan(rl2_Pixel* const dst, rl2_ARGB8888 const* const src, size_t const count, uint8_t const alpha) {
+    rl2_selectKernels();
+
+    rl2_kernels.premultiply(dst, src, count, alpha);
+}
+
+void rl2_xrgb8888Span(uint32_t* const dst, rl2_Pixel const* const src, size_t const count) {
+    rl2_selectKernels();
+
+    rl2_kernels.xrgb8888(dst, src, count);
+}
+
+void rl2_abgr8888Span(uint32_t* const dst, rl2_Pixel const* const src, size_t const count) {
+    rl2_selectKernels();
+
+    rl2_kernels.abgr8888(dst, src, count);
+}
+
+void rl2_rgb555Span(uint16_t* const dst, rl2_Pixel const* const src, size_t const count) {
+    rl2_selectKernels();
+
+    rl2_kernels.rgb555(dst, src, count);
+}
+
+void rl2_reverseSpan(rl2_ARGB8888* const dst, rl2_ARGB8888 const* const src, size_t const count) {
+    rl2_selectKernels();
+
+    rl2_kernels.reverse(dst, src, count);
+}
+
+void rl2_transposeBlock(
+    rl2_ARGB8888* const dst, ptrdiff_t const dst_pitch, rl2_ARGB8888 const* const src, ptrdiff_t const src_pitch,
+    unsigned const width, unsigned const height) {
+
+    rl2_selectKernels();
+
+    rl2_kernels.transpose(dst, dst_pitch, src, src_pitch, width, height);
+}
+
+void rl2_blendArgbSpan(rl2_ARGB8888* const dst, rl2_ARGB8888 const* const src, size_t const count) {
+    rl2_selectKernels();
+
+    rl2_kernels.blend_argb(dst, src, count);
+}
+
+void rl2_rgb565Span(uint16_t* const dst, rl2_ARGB8888 const* const src, size_t const count, uint32_t const dither) {
+    rl2_selectKernels();
+
+    rl2_kernels.rgb565(dst, src, count, dither);
+}
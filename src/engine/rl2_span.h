@@ -0,0 +1,56 @@
+#ifndef RL2_SPAN_H__
+#define RL2_SPAN_H__
+
+#include "rl2_canvas.h"
+#include "rl2_pixelsrc.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Selects the kernels for the CPU, done once on first use from any thread; calling it up front only moves the cost
+void rl2_selectKernels(void);
+
+// Composes count premultiplied src pixels over dst, dst = src + dst * inv_alpha / 32
+void rl2_composeSpan(rl2_Pixel* const dst, rl2_Pixel const* const src, size_t const count, uint8_t const inv_alpha);
+
+// Sets count pixels to color
+void rl2_fillSpan(rl2_Pixel* const dst, size_t const count, rl2_Pixel const color);
+
+// Composes the premultiplied color over count pixels, same as rl2_composeSpan with a constant source
+void rl2_blendSpan(rl2_Pixel* const dst, size_t const count, rl2_Pixel const color, uint8_t const inv_alpha);
+
+// Quantizes the alpha of count pixels to the 0..32 levels used by the RLE encoder, (alpha + 4) / 8
+void rl2_alphaLevels(uint8_t* const levels, rl2_ARGB8888 const* const src, size_t const count);
+
+// Converts count pixels to the canvas format, ignoring alpha
+void rl2_convertSpan(rl2_Pixel* const dst, rl2_ARGB8888 const* const src, size_t const count);
+
+// Converts count pixels to the canvas format after multiplying their color channels by alpha / 255
+void rl2_premultiplySpan(rl2_Pixel* const dst, rl2_ARGB8888 const* const src, size_t const count, uint8_t const alpha);
+
+// Converts count canvas pixels to 0xffRRGGBB and 0xffBBGGRR words; RGB565 channels get their top bits replicated into
+// the new low ones so that white stays white
+void rl2_xrgb8888Span(uint32_t* const dst, rl2_Pixel const* const src, size_t const count);
+void rl2_abgr8888Span(uint32_t* const dst, rl2_Pixel const* const src, size_t const count);
+
+// Converts count canvas pixels to RGB555, dropping the low bits of each channel
+void rl2_rgb555Span(uint16_t* const dst, rl2_Pixel const* const src, size_t const count);
+
+// Writes count pixels in reverse order, dst[i] = src[count - 1 - i]; dst and src must not overlap
+void rl2_reverseSpan(rl2_ARGB8888* const dst, rl2_ARGB8888 const* const src, size_t const count);
+
+// Writes the transpose of the width by height block at src to dst, dst[x * dst_pitch + y] = src[y * src_pitch + x];
+// pitches are in pixels and can be negative to walk rows upwards. Blocks should be small enough to stay in cache
+void rl2_transposeBlock(
+    rl2_ARGB8888* const dst, ptrdiff_t const dst_pitch, rl2_ARGB8888 const* const src, ptrdiff_t const src_pitch,
+    unsigned const width, unsigned const height);
+
+// Blends count non-premultiplied src pixels over dst, dst = (src * a + dst * (255 - a)) / 255 with a the source
+// alpha; the destination alpha becomes a + dst_alpha * (255 - a) / 255
+void rl2_blendArgbSpan(rl2_ARGB8888* const dst, rl2_ARGB8888 const* const src, size_t const count);
+
+// Converts count pixels to RGB565 regardless of the canvas format. Byte (i & 3) of dither is a 0..15 threshold added
+// to the channels of pixel i before truncating, scaled to the bits each channel loses; zero doesn't dither
+void rl2_rgb565Span(uint16_t* const dst, rl2_ARGB8888 const* const src, size_t const count, uint32_t const dither);
+
+#endif // RL2_SPAN_H__
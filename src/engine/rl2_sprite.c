@@ -1,13 +1,21 @@
 #include "rl2_sprite.h"
 #include "rl2_log.h"
 #include "rl2_heap.h"
+#include "rl2_jobs.h"
 
 #include <stdlib.h>
 #include <string.h>
 
 #define TAG "SPT "
 
-#define RL2_MIN_SPRITES 64
+// Sprites are allocated in chunks that never move, so handles stay valid while the pool grows
+#define RL2_SPRITES_PER_CHUNK 256
+#define RL2_NO_SLOT UINT32_MAX
+
+#define RL2_MAX_BANDS 64
+
+// Opaque rectangles of the sprites on top that can hide the ones below, only the largest ones are kept
+#define RL2_MAX_OCCLUDERS 16
 
 typedef enum {
     RL2_SPRITE_INVISIBLE = 0x4000U,
@@ -17,171 +25,890 @@ typedef enum {
 }
 rl2_SpriteFlags;
 
-struct rl2_Sprite {
-    rl2_Image image;
-    rl2_RGB565* bg;
+// How sprites drawn by rl2_blitSprites are erased by rl2_unblitSprites
+typedef enum {
+    // Each sprite saved the pixels it overwrote in its bg buffer, restore them in reverse order
+    RL2_RESTORE_SAVED,
 
-    int x;
-    int y;
+    // Copy the rectangle of each sprite from the background canvas
+    RL2_RESTORE_RECTS,
 
-    uint16_t flags; // Sprite layer [0..16383] | visibility << 14 | << unused << 15
+    // The sprites cover more than the canvas, copy the whole background
+    RL2_RESTORE_ALL
+}
+rl2_RestoreMode;
+
+// Only what isn't needed to sort and draw the sprites lives here, the rest is in the arrays indexed by slot below
+struct rl2_Sprite {
+    uint32_t slot;
+    uint32_t next_free;
+
+    rl2_Pixel* bg;
+    size_t bg_size; // in pixels, allocated on the first rl2_blitSprites that needs it, kept when the slot is reused
 };
 
-static rl2_Sprite* rl2_sprites = NULL;
+static struct rl2_Sprite** rl2_spriteChunks = NULL;
+static size_t rl2_spriteChunkCount = 0;
+static uint32_t rl2_usedSlots = 0;
+static uint32_t rl2_freeSlot = RL2_NO_SLOT;
+
+// Hot sprite data, indexed by slot
+static int* rl2_spriteX = NULL;
+static int* rl2_spriteY = NULL;
+static uint16_t* rl2_spriteFlags = NULL; // Sprite layer [0..16383] | visibility << 14 | << unused << 15
+static rl2_Image* rl2_spriteImages = NULL;
+static uint8_t* rl2_spriteFlips = NULL; // rl2_ImageFlip flags
+
+// Slots of all live sprites kept sorted by key, rl2_sortedSlots is the scratch area for the radix sort
+static uint32_t* rl2_sprites = NULL;
+static uint32_t* rl2_sortedSlots = NULL;
+static bool rl2_spritesSorted = true;
 static size_t rl2_spriteCount = 0;
-static size_t rl2_reservedSprites = 0;
 static size_t rl2_visibleSpriteCount = 0;
+static rl2_Canvas rl2_spriteBackground = NULL;
+static rl2_RestoreMode rl2_restoreMode = RL2_RESTORE_SAVED;
+static rl2_Canvas rl2_restoreBackground = NULL; // rl2_spriteBackground when rl2_blitSprites chose rl2_restoreMode
+static uint8_t* rl2_spriteCulled = NULL; // hidden behind opaque sprites on top, not drawn nor erased, indexed by slot
+
+// Incremental redraw leaves sprites on the canvas between frames and remembers how each one was drawn, indexed by
+// slot; rl2_drawnSlots has the drawn sprites in the order they were drawn
+static bool rl2_incremental = false;
+static bool rl2_redrawAll = false;
+static rl2_RestoreMode rl2_drawnMode = RL2_RESTORE_SAVED;
+static rl2_Canvas rl2_drawnBackground = NULL;
+
+// Band rendering, rl2_bandSlots has the sprites that touch each band in draw order, from rl2_bandStart[band] to
+// rl2_bandStart[band + 1]
+static unsigned rl2_spriteBands = 1;
+static unsigned rl2_drawnBands = 1;
+static unsigned rl2_bandHeight = 0;
+static uint32_t* rl2_bandSlots = NULL;
+static size_t rl2_bandSlotsSize = 0;
+static size_t rl2_bandStart[RL2_MAX_BANDS + 1];
+static int* rl2_drawnX = NULL;
+static int* rl2_drawnY = NULL;
+static rl2_Image* rl2_drawnImages = NULL;
+static uint8_t* rl2_drawnFlips = NULL;
+static uint32_t* rl2_drawnIndex = NULL; // position in rl2_drawnSlots, or RL2_NO_SLOT
+static uint32_t* rl2_drawnSlots = NULL;
+static size_t rl2_drawnCount = 0;
+
+// Sprites changed since the last frame, and work areas to find out what has to be redrawn because of them
+static uint8_t* rl2_spriteDirty = NULL;
+static uint32_t* rl2_dirtySlots = NULL;
+static size_t rl2_dirtyCount = 0;
+static uint32_t* rl2_orderIndex = NULL; // position in rl2_sprites of the visible sprites
+static uint32_t* rl2_redrawSlots = NULL;
+
+typedef struct {
+    int64_t x0;
+    int64_t y0;
+    int64_t x1;
+    int64_t y1;
+}
+rl2_Area;
 
-rl2_Sprite rl2_createSprite(void) {
-    rl2_Sprite sprite = (rl2_Sprite)rl2_alloc(sizeof(*sprite));
+static rl2_Sprite rl2_spriteAt(uint32_t const slot) {
+    return rl2_spriteChunks[slot / RL2_SPRITES_PER_CHUNK] + slot % RL2_SPRITES_PER_CHUNK;
+}
+
+static bool rl2_growArray(void** const array, size_t const element_size, size_t const count) {
+    void* const new_array = rl2_realloc(*array, element_size * count);
+
+    if (new_array == NULL) {
+        return false;
+    }
+
+    *array = new_array;
+    return true;
+}
+
+static bool rl2_addSpriteChunk(void) {
+    size_t const capacity = (rl2_spriteChunkCount + 1) * RL2_SPRITES_PER_CHUNK;
+
+    if (capacity > RL2_NO_SLOT) {
+        RL2_ERROR(TAG "too many sprites");
+        return false;
+    }
+
+    // Arrays that grew are kept even if a later one fails, they'll just have room to spare
+    if (!rl2_growArray((void**)&rl2_spriteX, sizeof(*rl2_spriteX), capacity) ||
+        !rl2_growArray((void**)&rl2_spriteY, sizeof(*rl2_spriteY), capacity) ||
+        !rl2_growArray((void**)&rl2_spriteFlags, sizeof(*rl2_spriteFlags), capacity) ||
+        !rl2_growArray((void**)&rl2_spriteImages, sizeof(*rl2_spriteImages), capacity) ||
+        !rl2_growArray((void**)&rl2_spriteFlips, sizeof(*rl2_spriteFlips), capacity) ||
+        !rl2_growArray((void**)&rl2_sprites, sizeof(*rl2_sprites), capacity) ||
+        !rl2_growArray((void**)&rl2_sortedSlots, sizeof(*rl2_sortedSlots), capacity) ||
+        !rl2_growArray((void**)&rl2_spriteCulled, sizeof(*rl2_spriteCulled), capacity) ||
+        !rl2_growArray((void**)&rl2_drawnX, sizeof(*rl2_drawnX), capacity) ||
+        !rl2_growArray((void**)&rl2_drawnY, sizeof(*rl2_drawnY), capacity) ||
+        !rl2_growArray((void**)&rl2_drawnImages, sizeof(*rl2_drawnImages), capacity) ||
+        !rl2_growArray((void**)&rl2_drawnFlips, sizeof(*rl2_drawnFlips), capacity) ||
+        !rl2_growArray((void**)&rl2_drawnIndex, sizeof(*rl2_drawnIndex), capacity) ||
+        !rl2_growArray((void**)&rl2_drawnSlots, sizeof(*rl2_drawnSlots), capacity) ||
+        !rl2_growArray((void**)&rl2_spriteDirty, sizeof(*rl2_spriteDirty), capacity) ||
+        !rl2_growArray((void**)&rl2_dirtySlots, sizeof(*rl2_dirtySlots), capacity) ||
+        !rl2_growArray((void**)&rl2_orderIndex, sizeof(*rl2_orderIndex), capacity) ||
+        !rl2_growArray((void**)&rl2_redrawSlots, sizeof(*rl2_redrawSlots), capacity) ||
+        !rl2_growArray((void**)&rl2_spriteChunks, sizeof(*rl2_spriteChunks), rl2_spriteChunkCount + 1)) {
 
-    if (sprite == NULL) {
         RL2_ERROR(TAG "out of memory");
-        return NULL;
+        return false;
     }
 
-    if (rl2_spriteCount == rl2_reservedSprites) {
-        size_t const new_reserved = rl2_reservedSprites == 0 ? RL2_MIN_SPRITES : rl2_reservedSprites * 2;
-        rl2_Sprite* const new_entries = rl2_realloc(rl2_sprites, sizeof(rl2_Sprite) * new_reserved);
+    struct rl2_Sprite* const chunk = (struct rl2_Sprite*)rl2_alloc(sizeof(*chunk) * RL2_SPRITES_PER_CHUNK);
 
-        if (new_entries == NULL) {
-            RL2_ERROR(TAG "out of memory");
-            rl2_free(sprite);
+    if (chunk == NULL) {
+        RL2_ERROR(TAG "out of memory");
+        return false;
+    }
+
+    for (uint32_t i = 0; i < RL2_SPRITES_PER_CHUNK; i++) {
+        chunk[i].slot = (uint32_t)(rl2_spriteChunkCount * RL2_SPRITES_PER_CHUNK + i);
+        chunk[i].next_free = RL2_NO_SLOT;
+        chunk[i].bg = NULL;
+        chunk[i].bg_size = 0;
+    }
+
+    rl2_spriteChunks[rl2_spriteChunkCount++] = chunk;
+    return true;
+}
+
+rl2_Sprite rl2_createSprite(void) {
+    uint32_t slot = rl2_freeSlot;
+
+    if (slot != RL2_NO_SLOT) {
+        rl2_freeSlot = rl2_spriteAt(slot)->next_free;
+    }
+    else {
+        if (rl2_usedSlots == rl2_spriteChunkCount * RL2_SPRITES_PER_CHUNK && !rl2_addSpriteChunk()) {
+            // Error already logged
             return NULL;
         }
 
-        rl2_reservedSprites = new_reserved;
-        rl2_sprites = new_entries;
+        slot = rl2_usedSlots++;
     }
 
-    sprite->image = NULL;
-    sprite->bg = NULL;
-    sprite->x = sprite->y = 0;
-    sprite->flags = RL2_SPRITE_INVISIBLE;
+    rl2_spriteImages[slot] = NULL;
+    rl2_spriteFlips[slot] = RL2_FLIP_NONE;
+    rl2_spriteX[slot] = rl2_spriteY[slot] = 0;
+    rl2_spriteFlags[slot] = RL2_SPRITE_INVISIBLE;
 
-    rl2_sprites[rl2_spriteCount++] = sprite;
-    return sprite;
+    // Slots are only reused after the frame that destroyed their sprite erased it
+    rl2_drawnIndex[slot] = RL2_NO_SLOT;
+    rl2_spriteDirty[slot] = 0;
+
+    // New sprites are invisible and go after the visible ones, so the order of what is drawn doesn't change
+    rl2_sprites[rl2_spriteCount++] = slot;
+    return rl2_spriteAt(slot);
+}
+
+// Sprites are drawn in ascending key order, visible ones first ordered by layer, then the invisible ones, then the
+// ones marked for destruction
+static uint16_t rl2_spriteKey(uint32_t const slot) {
+    return rl2_spriteFlags[slot] | (RL2_SPRITE_INVISIBLE * (rl2_spriteImages[slot] == NULL));
+}
+
+static void rl2_markDirty(uint32_t const slot) {
+    if (rl2_incremental && !rl2_spriteDirty[slot]) {
+        rl2_spriteDirty[slot] = 1;
+        rl2_dirtySlots[rl2_dirtyCount++] = slot;
+    }
+}
+
+static void rl2_setKey(uint32_t const slot, uint16_t const flags, rl2_Image const image) {
+    uint16_t const old_key = rl2_spriteKey(slot);
+
+    if (flags != rl2_spriteFlags[slot] || image != rl2_spriteImages[slot]) {
+        rl2_markDirty(slot);
+    }
+
+    rl2_spriteFlags[slot] = flags;
+    rl2_spriteImages[slot] = image;
+
+    if (rl2_spriteKey(slot) != old_key) {
+        rl2_spritesSorted = false;
+    }
 }
 
 void rl2_destroySprite(rl2_Sprite const sprite) {
-    sprite->flags = RL2_SPRITE_DESTROY;
+    rl2_setKey(sprite->slot, RL2_SPRITE_DESTROY, rl2_spriteImages[sprite->slot]);
 }
 
 void rl2_setPosition(rl2_Sprite const sprite, int x, int y) {
-    sprite->x = x;
-    sprite->y = y;
+    if (x != rl2_spriteX[sprite->slot] || y != rl2_spriteY[sprite->slot]) {
+        rl2_markDirty(sprite->slot);
+    }
+
+    rl2_spriteX[sprite->slot] = x;
+    rl2_spriteY[sprite->slot] = y;
 }
 
 void rl2_setLayer(rl2_Sprite const sprite, unsigned const layer) {
-    sprite->flags = (sprite->flags & RL2_SPRITE_FLAGS) | (layer & RL2_SPRITE_LAYER);
+    uint32_t const slot = sprite->slot;
+    rl2_setKey(slot, (rl2_spriteFlags[slot] & RL2_SPRITE_FLAGS) | (layer & RL2_SPRITE_LAYER), rl2_spriteImages[slot]);
 }
 
 bool rl2_setImage(rl2_Sprite const sprite, rl2_Image const image) {
-    if (image == sprite->image) {
-        return true;
+    // The bg buffer is only (re)allocated by rl2_blitSprites if the sprite ever has to save pixels
+    rl2_setKey(sprite->slot, rl2_spriteFlags[sprite->slot], image);
+    return true;
+}
+
+void rl2_setFlip(rl2_Sprite const sprite, unsigned const flip) {
+    if (flip != rl2_spriteFlips[sprite->slot]) {
+        rl2_markDirty(sprite->slot);
     }
 
-    rl2_RGB565* bg = NULL;
+    rl2_spriteFlips[sprite->slot] = (uint8_t)flip;
+}
 
-    if (image != NULL) {
-        size_t const count = rl2_changedPixels(image);
-        bg = (rl2_RGB565*)rl2_alloc(count * sizeof(*sprite->bg));
+void rl2_setVisibility(rl2_Sprite const sprite, bool const visible) {
+    uint32_t const slot = sprite->slot;
 
-        if (bg == NULL) {
-            RL2_ERROR(TAG "out of memory");
-            return false;
-        }
+    if (visible) {
+        rl2_setKey(slot, rl2_spriteFlags[slot] & ~RL2_SPRITE_INVISIBLE, rl2_spriteImages[slot]);
     }
+    else {
+        rl2_setKey(slot, rl2_spriteFlags[slot] | RL2_SPRITE_INVISIBLE, rl2_spriteImages[slot]);
+    }
+}
 
-    rl2_free(sprite->bg);
+void rl2_setSpriteBackground(rl2_Canvas const background) {
+    rl2_spriteBackground = background;
+}
 
-    sprite->image = image;
+void rl2_setSpriteBands(unsigned const count) {
+    rl2_spriteBands = count == 0 ? 1 : count > RL2_MAX_BANDS ? RL2_MAX_BANDS : count;
+}
+
+void rl2_setIncrementalSprites(bool const enable) {
+    rl2_incremental = enable;
+    rl2_redrawAll = enable;
+
+    // Nothing is drawn when incremental redraw is turned on, and it's erased by rl2_blitSprites when turned off
+    for (size_t i = 0; i < rl2_dirtyCount; i++) {
+        rl2_spriteDirty[rl2_dirtySlots[i]] = 0;
+    }
+
+    rl2_dirtyCount = 0;
+}
+
+static bool rl2_reserveBg(rl2_Sprite const sprite, size_t const count) {
+    if (count <= sprite->bg_size) {
+        return true;
+    }
+
+    rl2_Pixel* const bg = (rl2_Pixel*)rl2_alloc(count * sizeof(*bg));
+
+    if (bg == NULL) {
+        RL2_ERROR(TAG "out of memory");
+        return false;
+    }
+
+    rl2_free(sprite->bg);
     sprite->bg = bg;
+    sprite->bg_size = count;
     return true;
 }
 
-void rl2_setVisibility(rl2_Sprite const sprite, bool const visible) {
-    if (visible) {
-        sprite->flags &= ~RL2_SPRITE_INVISIBLE;
+// Canvas area of rect inside the image drawn at (x, y)
+static rl2_Area rl2_rectArea(int const x, int const y, rl2_ImageRect const rect) {
+    rl2_Area area;
+
+    area.x0 = (int64_t)x + rect.x0;
+    area.y0 = (int64_t)y + rect.y0;
+    area.x1 = area.x0 + rect.width;
+    area.y1 = area.y0 + rect.height;
+    return area;
+}
+
+// Canvas area that drawing the sprite can change, trimmed borders are left out
+static rl2_Area rl2_spriteArea(uint32_t const slot) {
+    rl2_Image const image = rl2_spriteImages[slot];
+    rl2_ImageRect const bounds = rl2_flipRect(image, rl2_imageBounds(image), rl2_spriteFlips[slot]);
+    return rl2_rectArea(rl2_spriteX[slot], rl2_spriteY[slot], bounds);
+}
+
+// Same as above for how the sprite was last drawn with incremental redraw
+static rl2_Area rl2_drawnArea(uint32_t const slot) {
+    rl2_Image const image = rl2_drawnImages[slot];
+    rl2_ImageRect const bounds = rl2_flipRect(image, rl2_imageBounds(image), rl2_drawnFlips[slot]);
+    return rl2_rectArea(rl2_drawnX[slot], rl2_drawnY[slot], bounds);
+}
+
+static size_t rl2_visibleArea(uint32_t const slot, rl2_Canvas const canvas) {
+    rl2_Area const area = rl2_spriteArea(slot);
+
+    int64_t const x0 = area.x0, y0 = area.y0, x1 = area.x1, y1 = area.y1;
+    int64_t const width = rl2_canvasWidth(canvas), height = rl2_canvasHeight(canvas);
+
+    int64_t const left = x0 < 0 ? 0 : x0, top = y0 < 0 ? 0 : y0;
+    int64_t const right = x1 > width ? width : x1, bottom = y1 > height ? height : y1;
+
+    return left < right && top < bottom ? (size_t)((right - left) * (bottom - top)) : 0;
+}
+
+static rl2_RestoreMode rl2_chooseRestoreMode(rl2_Canvas const canvas, size_t const count) {
+    rl2_Canvas const background = rl2_spriteBackground;
+
+    if (background == NULL) {
+        return RL2_RESTORE_SAVED;
     }
-    else {
-        sprite->flags |= RL2_SPRITE_INVISIBLE;
+
+    if (rl2_canvasWidth(background) != rl2_canvasWidth(canvas) ||
+        rl2_canvasHeight(background) != rl2_canvasHeight(canvas)) {
+
+        RL2_WARN(TAG "sprite background doesn't have the same size as the canvas, ignoring it");
+        return RL2_RESTORE_SAVED;
+    }
+
+    // Saving and restoring moves each changed pixel twice, the background moves each covered pixel once
+    size_t const canvas_area = (size_t)rl2_canvasWidth(canvas) * rl2_canvasHeight(canvas);
+    size_t saved = 0, covered = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        uint32_t const slot = rl2_sprites[i];
+
+        if (rl2_spriteCulled[slot]) {
+            continue;
+        }
+
+        saved += 2 * rl2_changedPixels(rl2_spriteImages[slot]);
+        covered += rl2_visibleArea(slot, canvas);
+    }
+
+    if (covered >= canvas_area && canvas_area < saved) {
+        return RL2_RESTORE_ALL;
+    }
+
+    return covered < saved ? RL2_RESTORE_RECTS : RL2_RESTORE_SAVED;
+}
+
+static int64_t rl2_occluderArea(rl2_Area const* const occluder) {
+    return (occluder->x1 - occluder->x0) * (occluder->y1 - occluder->y0);
+}
+
+// Goes through the sprites from the top down, culling the ones that are completely inside the opaque rectangle of a
+// sprite drawn after them; only what's on the canvas counts, so sprites partially out of it can be culled too
+static void rl2_cullSprites(rl2_Canvas const canvas) {
+    int64_t const width = rl2_canvasWidth(canvas), height = rl2_canvasHeight(canvas);
+    rl2_Area occluders[RL2_MAX_OCCLUDERS];
+    size_t count = 0;
+
+    for (size_t i = rl2_visibleSpriteCount; i > 0; i--) {
+        uint32_t const slot = rl2_sprites[i - 1];
+        rl2_Image const image = rl2_spriteImages[slot];
+
+        int64_t const x0 = rl2_spriteX[slot], y0 = rl2_spriteY[slot];
+        rl2_Area const area = rl2_spriteArea(slot);
+        int64_t const left = area.x0 < 0 ? 0 : area.x0, top = area.y0 < 0 ? 0 : area.y0;
+        int64_t const right = area.x1 > width ? width : area.x1, bottom = area.y1 > height ? height : area.y1;
+
+        bool culled = false;
+
+        for (size_t j = 0; j < count && !culled && left < right && top < bottom; j++) {
+            culled = left >= occluders[j].x0 && right <= occluders[j].x1 &&
+                     top >= occluders[j].y0 && bottom <= occluders[j].y1;
+        }
+
+        rl2_spriteCulled[slot] = culled;
+
+        rl2_ImageRect const rect = rl2_flipRect(image, rl2_opaqueRect(image), rl2_spriteFlips[slot]);
+
+        if (culled || rect.width == 0) {
+            continue;
+        }
+
+        rl2_Area occluder;
+        occluder.x0 = x0 + rect.x0 < 0 ? 0 : x0 + rect.x0;
+        occluder.y0 = y0 + rect.y0 < 0 ? 0 : y0 + rect.y0;
+        occluder.x1 = x0 + rect.x0 + rect.width > width ? width : x0 + rect.x0 + rect.width;
+        occluder.y1 = y0 + rect.y0 + rect.height > height ? height : y0 + rect.y0 + rect.height;
+
+        if (occluder.x0 >= occluder.x1 || occluder.y0 >= occluder.y1) {
+            continue;
+        }
+
+        if (count < RL2_MAX_OCCLUDERS) {
+            occluders[count++] = occluder;
+            continue;
+        }
+
+        // Replace the smallest one if this one is larger
+        size_t smallest = 0;
+
+        for (size_t j = 1; j < count; j++) {
+            if (rl2_occluderArea(occluders + j) < rl2_occluderArea(occluders + smallest)) {
+                smallest = j;
+            }
+        }
+
+        if (rl2_occluderArea(&occluder) > rl2_occluderArea(occluders + smallest)) {
+            occluders[smallest] = occluder;
+        }
+    }
+}
+
+// Stable LSD radix sort of the sprites on their 16-bit keys, one pass per byte; passes where all sprites fall in
+// the same bucket, like the high byte when all layers are below 256, are skipped
+static void rl2_sortSprites(void) {
+    for (unsigned shift = 0; shift < 16 && rl2_spriteCount != 0; shift += 8) {
+        size_t offsets[256];
+        memset(offsets, 0, sizeof(offsets));
+
+        for (size_t i = 0; i < rl2_spriteCount; i++) {
+            offsets[(rl2_spriteKey(rl2_sprites[i]) >> shift) & 255]++;
+        }
+
+        if (offsets[(rl2_spriteKey(rl2_sprites[0]) >> shift) & 255] == rl2_spriteCount) {
+            continue;
+        }
+
+        for (size_t i = 0, total = 0; i < 256; i++) {
+            size_t const count = offsets[i];
+            offsets[i] = total;
+            total += count;
+        }
+
+        for (size_t i = 0; i < rl2_spriteCount; i++) {
+            uint32_t const slot = rl2_sprites[i];
+            rl2_sortedSlots[offsets[(rl2_spriteKey(slot) >> shift) & 255]++] = slot;
+        }
+
+        uint32_t* const sorted = rl2_sortedSlots;
+        rl2_sortedSlots = rl2_sprites;
+        rl2_sprites = sorted;
+    }
+
+    // Count the visible sprites, they're the only ones with both flags clear
+    size_t i = 0;
+
+    while (i < rl2_spriteCount && (rl2_spriteKey(rl2_sprites[i]) & RL2_SPRITE_FLAGS) == 0) {
+        i++;
+    }
+
+    rl2_visibleSpriteCount = i;
+
+    // Skip invisible sprites
+    while (i < rl2_spriteCount && (rl2_spriteKey(rl2_sprites[i]) & RL2_SPRITE_DESTROY) == 0) {
+        i++;
     }
+
+    // Return the slots of all remaining sprites to the free list
+    size_t const new_count = i;
+
+    for (; i < rl2_spriteCount; i++) {
+        rl2_Sprite const sprite = rl2_spriteAt(rl2_sprites[i]);
+        sprite->next_free = rl2_freeSlot;
+        rl2_freeSlot = sprite->slot;
+    }
+
+    rl2_spriteCount = new_count;
+    rl2_spritesSorted = true;
 }
 
-static int rl2_compareSprites(void const* e1, void const* e2) {
-    rl2_Sprite const s1 = *(rl2_Sprite*)e1;
-    rl2_Sprite const s2 = *(rl2_Sprite*)e2;
+static bool rl2_overlap(rl2_Area const area1, rl2_Area const area2) {
+    return area1.x0 < area2.x1 && area2.x0 < area1.x1 && area1.y0 < area2.y1 && area2.y0 < area1.y1;
+}
 
-    uint16_t const f1 = s1->flags | (RL2_SPRITE_INVISIBLE * (s1->image == NULL));
-    uint16_t const f2 = s2->flags | (RL2_SPRITE_INVISIBLE * (s2->image == NULL));
+static void rl2_copyArea(rl2_Canvas const canvas, rl2_Canvas const background, rl2_Area const area) {
+    rl2_copyRect(
+        canvas, background, (int)area.x0, (int)area.y0, (unsigned)(area.x1 - area.x0), (unsigned)(area.y1 - area.y0));
+}
 
-    if (f1 == f2) {
-        return 0;
+static void rl2_addRedraw(uint32_t const slot, size_t* const count) {
+    if (!rl2_spriteDirty[slot]) {
+        rl2_spriteDirty[slot] = 1;
+        rl2_redrawSlots[(*count)++] = slot;
     }
-    else if (f1 < f2) {
-        return -1;
+}
+
+static void rl2_eraseDrawn(rl2_Canvas const canvas, uint32_t const slot) {
+    if (rl2_drawnMode == RL2_RESTORE_SAVED) {
+        rl2_unblitFlipped(
+            rl2_drawnImages[slot], canvas, rl2_drawnX[slot], rl2_drawnY[slot], rl2_drawnFlips[slot],
+            rl2_spriteAt(slot)->bg);
     }
     else {
-        return 1;
+        rl2_copyArea(canvas, rl2_drawnBackground, rl2_drawnArea(slot));
     }
 }
 
-void rl2_blitSprites(rl2_Canvas const canvas) {
-    if (rl2_spriteCount == 0) {
-        return;
+// Sprites have to be erased in the reverse order they were drawn, so erasing a sprite means erasing everything
+// drawn after it on top of it too, or, when erasing from the background, everything on top or below it. Sprites to
+// draw have to be drawn after everything that comes before them in the new order, so drawing a sprite means drawing
+// everything after it that overlaps it. The changed sprites are grown with these rules until nothing else is added,
+// and only those are erased and drawn again
+static void rl2_redrawSprites(rl2_Canvas const canvas) {
+    rl2_Canvas background = rl2_spriteBackground;
+
+    if (background != NULL && (rl2_canvasWidth(background) != rl2_canvasWidth(canvas) ||
+                               rl2_canvasHeight(background) != rl2_canvasHeight(canvas))) {
+
+        RL2_WARN(TAG "sprite background doesn't have the same size as the canvas, ignoring it");
+        background = NULL;
     }
 
-    qsort(rl2_sprites, rl2_spriteCount, sizeof(*rl2_sprites), rl2_compareSprites);
+    rl2_RestoreMode const mode = background != NULL ? RL2_RESTORE_RECTS : RL2_RESTORE_SAVED;
+    size_t count = 0;
 
-    size_t i = 0;
-    rl2_Sprite sprite = rl2_sprites[0];
+    for (size_t i = 0; i < rl2_visibleSpriteCount; i++) {
+        rl2_orderIndex[rl2_sprites[i]] = (uint32_t)i;
+    }
 
-    // Blit all sprites not invisible and not marked for destruction
-    if (i < rl2_spriteCount && (sprite->flags & RL2_SPRITE_FLAGS) == 0 && sprite->image != NULL) {
-        do {
-            rl2_blit(sprite->image, canvas, sprite->x, sprite->y, sprite->bg);
-            sprite = rl2_sprites[++i];
+    if (rl2_redrawAll || (rl2_drawnCount != 0 && (mode != rl2_drawnMode || background != rl2_drawnBackground))) {
+        // Sprites were drawn in a way that can't be mixed with the new one, or incremental redraw was just turned on
+        // and there is nothing on the canvas yet, start over
+        for (size_t i = 0; i < rl2_drawnCount; i++) {
+            rl2_addRedraw(rl2_drawnSlots[i], &count);
+        }
+
+        for (size_t i = 0; i < rl2_visibleSpriteCount; i++) {
+            rl2_addRedraw(rl2_sprites[i], &count);
         }
-        while (i < rl2_spriteCount && (sprite->flags & RL2_SPRITE_FLAGS) == 0 && sprite->image != NULL);
     }
 
-    rl2_visibleSpriteCount = i;
+    // The dirty flags of the changed sprites are already set
+    for (size_t i = 0; i < rl2_dirtyCount; i++) {
+        rl2_redrawSlots[count++] = rl2_dirtySlots[i];
+    }
 
-    // Skip invisible sprites
-    if (i < rl2_spriteCount && ((sprite->flags & RL2_SPRITE_FLAGS) == RL2_SPRITE_INVISIBLE || sprite->image == NULL)) {
-        do {
-            sprite = rl2_sprites[++i];
+    rl2_dirtyCount = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        uint32_t const slot = rl2_redrawSlots[i];
+        uint32_t const drawn = rl2_drawnIndex[slot];
+
+        if (drawn != RL2_NO_SLOT) {
+            rl2_Area const area = rl2_drawnArea(slot);
+            size_t const first = rl2_drawnMode == RL2_RESTORE_SAVED ? drawn + 1 : 0;
+
+            for (size_t j = first; j < rl2_drawnCount; j++) {
+                uint32_t const other = rl2_drawnSlots[j];
+
+                if (!rl2_spriteDirty[other] && rl2_overlap(area, rl2_drawnArea(other))) {
+                    rl2_addRedraw(other, &count);
+                }
+            }
+        }
+
+        if ((rl2_spriteKey(slot) & RL2_SPRITE_FLAGS) == 0) {
+            rl2_Area const area = rl2_spriteArea(slot);
+
+            for (size_t j = rl2_orderIndex[slot] + 1; j < rl2_visibleSpriteCount; j++) {
+                uint32_t const other = rl2_sprites[j];
+
+                if (!rl2_spriteDirty[other] && rl2_overlap(area, rl2_spriteArea(other))) {
+                    rl2_addRedraw(other, &count);
+                }
+            }
         }
-        while (i < rl2_spriteCount && ((sprite->flags & RL2_SPRITE_FLAGS) == RL2_SPRITE_INVISIBLE || sprite->image == NULL));
     }
 
-    // Destroy all remaining sprites
-    size_t const new_count = i;
+    // Erase in the reverse order they were drawn, keeping the ones that stay on the canvas in the same order
+    size_t kept = 0;
+
+    for (size_t i = rl2_drawnCount; i > 0; i--) {
+        uint32_t const slot = rl2_drawnSlots[i - 1];
 
-    if (i < rl2_spriteCount) {
-        do {
-            rl2_free(sprite->bg);
-            rl2_free(sprite);
-            sprite = rl2_sprites[++i];
+        if (rl2_spriteDirty[slot]) {
+            rl2_eraseDrawn(canvas, slot);
+            rl2_drawnIndex[slot] = RL2_NO_SLOT;
         }
-        while (i < rl2_spriteCount);
     }
 
-    rl2_spriteCount = new_count;
+    for (size_t i = 0; i < rl2_drawnCount; i++) {
+        uint32_t const slot = rl2_drawnSlots[i];
+
+        if (rl2_drawnIndex[slot] != RL2_NO_SLOT) {
+            rl2_drawnIndex[slot] = (uint32_t)kept;
+            rl2_drawnSlots[kept++] = slot;
+        }
+    }
+
+    // Draw in the new order, after everything that was kept
+    for (size_t i = 0; i < rl2_visibleSpriteCount; i++) {
+        uint32_t const slot = rl2_sprites[i];
+
+        if (!rl2_spriteDirty[slot]) {
+            continue;
+        }
+
+        rl2_Image const image = rl2_spriteImages[slot];
+        rl2_Sprite const sprite = rl2_spriteAt(slot);
+
+        if (mode == RL2_RESTORE_RECTS) {
+            rl2_stampFlipped(image, canvas, rl2_spriteX[slot], rl2_spriteY[slot], rl2_spriteFlips[slot]);
+        }
+        else if (rl2_reserveBg(sprite, rl2_changedPixels(image))) {
+            rl2_blitFlipped(image, canvas, rl2_spriteX[slot], rl2_spriteY[slot], rl2_spriteFlips[slot], sprite->bg);
+        }
+        else {
+            // Not drawn, so it won't be erased either
+            continue;
+        }
+
+        rl2_drawnX[slot] = rl2_spriteX[slot];
+        rl2_drawnY[slot] = rl2_spriteY[slot];
+        rl2_drawnImages[slot] = image;
+        rl2_drawnFlips[slot] = rl2_spriteFlips[slot];
+        rl2_drawnIndex[slot] = (uint32_t)kept;
+        rl2_drawnSlots[kept++] = slot;
+    }
+
+    rl2_drawnCount = kept;
+    rl2_drawnMode = mode;
+    rl2_drawnBackground = background;
+    rl2_redrawAll = false;
+
+    for (size_t i = 0; i < count; i++) {
+        rl2_spriteDirty[rl2_redrawSlots[i]] = 0;
+    }
 }
 
-void rl2_unblitSprites(rl2_Canvas const canvas) {
+static void rl2_eraseAllDrawn(rl2_Canvas const canvas) {
+    for (size_t i = rl2_drawnCount; i > 0; i--) {
+        uint32_t const slot = rl2_drawnSlots[i - 1];
+
+        rl2_eraseDrawn(canvas, slot);
+        rl2_drawnIndex[slot] = RL2_NO_SLOT;
+    }
+
+    rl2_drawnCount = 0;
+}
+
+// Bins the sprites by the bands they touch, keeping them in draw order inside each band
+static bool rl2_binSprites(rl2_Canvas const canvas, unsigned const bands) {
+    unsigned const height = rl2_canvasHeight(canvas);
+    unsigned const band_height = (height + bands - 1) / bands;
+    size_t counts[RL2_MAX_BANDS];
+    size_t total = 0;
+
+    memset(counts, 0, sizeof(counts));
+
+    for (int pass = 0; pass < 2; pass++) {
+        for (size_t i = 0; i < rl2_visibleSpriteCount; i++) {
+            uint32_t const slot = rl2_sprites[i];
+
+            if (rl2_spriteCulled[slot]) {
+                continue;
+            }
+
+            if (rl2_restoreMode == RL2_RESTORE_SAVED && rl2_spriteAt(slot)->bg_size == 0) {
+                // Couldn't reserve its bg buffer
+                continue;
+            }
+
+            rl2_Area const area = rl2_spriteArea(slot);
+            int64_t const y0 = area.y0, y1 = area.y1;
+
+            if (y1 <= 0 || y0 >= height) {
+                continue;
+            }
+
+            unsigned const first = y0 <= 0 ? 0 : (unsigned)y0 / band_height;
+            unsigned const last = (y1 >= height ? height - 1 : (unsigned)y1 - 1) / band_height;
+
+            for (unsigned band = first; band <= last; band++) {
+                if (pass == 0) {
+                    counts[band]++;
+                }
+                else {
+                    rl2_bandSlots[rl2_bandStart[band] + counts[band]++] = slot;
+                }
+            }
+        }
+
+        if (pass == 0) {
+            for (unsigned band = 0; band < bands; band++) {
+                rl2_bandStart[band] = total;
+                total += counts[band];
+                counts[band] = 0;
+            }
+
+            rl2_bandStart[bands] = total;
+
+            if (total > rl2_bandSlotsSize) {
+                if (!rl2_growArray((void**)&rl2_bandSlots, sizeof(*rl2_bandSlots), total)) {
+                    RL2_ERROR(TAG "out of memory");
+                    return false;
+                }
+
+                rl2_bandSlotsSize = total;
+            }
+        }
+    }
+
+    rl2_bandHeight = band_height;
+    return true;
+}
+
+static void rl2_bandRows(rl2_Canvas const canvas, size_t const band, unsigned* const top, unsigned* const bottom) {
+    unsigned const height = rl2_canvasHeight(canvas);
+
+    *top = (unsigned)band * rl2_bandHeight;
+    *bottom = *top + rl2_bandHeight < height ? *top + rl2_bandHeight : height;
+}
+
+static void rl2_blitBandJob(void* const userdata, size_t const band) {
+    rl2_Canvas const canvas = (rl2_Canvas)userdata;
+    unsigned top, bottom;
+    rl2_bandRows(canvas, band, &top, &bottom);
+
+    for (size_t i = rl2_bandStart[band]; i < rl2_bandStart[band + 1]; i++) {
+        uint32_t const slot = rl2_bandSlots[i];
+        rl2_Image const image = rl2_spriteImages[slot];
+
+        if (rl2_restoreMode != RL2_RESTORE_SAVED) {
+            rl2_stampBand(image, canvas, rl2_spriteX[slot], rl2_spriteY[slot], rl2_spriteFlips[slot], top, bottom);
+        }
+        else {
+            rl2_blitBand(
+                image, canvas, rl2_spriteX[slot], rl2_spriteY[slot], rl2_spriteFlips[slot], rl2_spriteAt(slot)->bg,
+                top, bottom);
+        }
+    }
+}
+
+static void rl2_unblitBandJob(void* const userdata, size_t const band) {
+    rl2_Canvas const canvas = (rl2_Canvas)userdata;
+    unsigned top, bottom;
+    rl2_bandRows(canvas, band, &top, &bottom);
+
+    for (size_t i = rl2_bandStart[band + 1]; i > rl2_bandStart[band]; i--) {
+        uint32_t const slot = rl2_bandSlots[i - 1];
+
+        rl2_unblitBand(
+            rl2_spriteImages[slot], canvas, rl2_spriteX[slot], rl2_spriteY[slot], rl2_spriteFlips[slot],
+            rl2_spriteAt(slot)->bg, top, bottom);
+    }
+}
+
+// Band jobs don't report damage to avoid racing on the canvas, do it for all of them here
+static void rl2_damageBands(rl2_Canvas const canvas) {
+    for (size_t i = 0; i < rl2_visibleSpriteCount; i++) {
+        uint32_t const slot = rl2_sprites[i];
+
+        if (rl2_spriteCulled[slot]) {
+            continue;
+        }
+
+        rl2_Area const area = rl2_spriteArea(slot);
+        rl2_damageCanvas(
+            canvas, (int)area.x0, (int)area.y0, (unsigned)(area.x1 - area.x0), (unsigned)(area.y1 - area.y0));
+    }
+}
+
+void rl2_blitSprites(rl2_Canvas const canvas) {
+    if (!rl2_spritesSorted) {
+        rl2_sortSprites();
+    }
+
+    if (rl2_incremental) {
+        rl2_redrawSprites(canvas);
+        return;
+    }
+    else if (rl2_drawnCount != 0) {
+        // Incremental redraw was just turned off
+        rl2_eraseAllDrawn(canvas);
+    }
+
     if (rl2_visibleSpriteCount == 0) {
         return;
     }
 
-    size_t i = rl2_visibleSpriteCount;
-    rl2_Sprite sprite = rl2_sprites[i - 1];
+    rl2_cullSprites(canvas);
+    rl2_restoreMode = rl2_chooseRestoreMode(canvas, rl2_visibleSpriteCount);
+    rl2_restoreBackground = rl2_restoreMode != RL2_RESTORE_SAVED ? rl2_spriteBackground : NULL;
+    rl2_drawnBands = rl2_spriteBands < rl2_canvasHeight(canvas) ? rl2_spriteBands : 1;
+
+    if (rl2_restoreMode == RL2_RESTORE_SAVED) {
+        // Reserve bg buffers up front, bands save the pixels of each image row at fixed offsets which takes more room
+        for (size_t i = 0; i < rl2_visibleSpriteCount; i++) {
+            uint32_t const slot = rl2_sprites[i];
+            rl2_Image const image = rl2_spriteImages[slot];
+            rl2_Sprite const sprite = rl2_spriteAt(slot);
+            size_t const count = rl2_drawnBands > 1 ? rl2_bandBufferSize(image) : rl2_changedPixels(image);
+
+            if (rl2_spriteCulled[slot]) {
+                continue;
+            }
+
+            if (!rl2_reserveBg(sprite, count)) {
+                // Don't draw what can't be erased, rl2_unblitSprites will skip it too
+                sprite->bg_size = 0;
+            }
+        }
+    }
+
+    if (rl2_drawnBands > 1 && !rl2_binSprites(canvas, rl2_drawnBands)) {
+        rl2_drawnBands = 1;
+    }
+
+    if (rl2_drawnBands > 1) {
+        rl2_parallelFor(rl2_blitBandJob, canvas, rl2_drawnBands);
+        rl2_damageBands(canvas);
+        return;
+    }
+
+    // Blit them, saving the overwritten pixels only if they won't come from the background
+    for (size_t i = 0; i < rl2_visibleSpriteCount; i++) {
+        uint32_t const slot = rl2_sprites[i];
+        rl2_Image const image = rl2_spriteImages[slot];
+
+        if (rl2_spriteCulled[slot]) {
+            continue;
+        }
+
+        if (rl2_restoreMode != RL2_RESTORE_SAVED) {
+            rl2_stampFlipped(image, canvas, rl2_spriteX[slot], rl2_spriteY[slot], rl2_spriteFlips[slot]);
+        }
+        else if (rl2_spriteAt(slot)->bg_size != 0) {
+            rl2_blitFlipped(
+                image, canvas, rl2_spriteX[slot], rl2_spriteY[slot], rl2_spriteFlips[slot], rl2_spriteAt(slot)->bg);
+        }
+    }
+}
+
+void rl2_unblitSprites(rl2_Canvas const canvas) {
+    if (rl2_incremental || rl2_visibleSpriteCount == 0) {
+        return;
+    }
+
+    if (rl2_restoreMode == RL2_RESTORE_ALL) {
+        rl2_copyRect(canvas, rl2_restoreBackground, 0, 0, rl2_canvasWidth(canvas), rl2_canvasHeight(canvas));
+        return;
+    }
+    else if (rl2_restoreMode == RL2_RESTORE_RECTS) {
+        // Rectangles come from the background, so the order doesn't matter
+        for (size_t i = 0; i < rl2_visibleSpriteCount; i++) {
+            uint32_t const slot = rl2_sprites[i];
+
+            if (rl2_spriteCulled[slot]) {
+                continue;
+            }
+
+            rl2_copyArea(canvas, rl2_restoreBackground, rl2_spriteArea(slot));
+        }
 
-    do {
-        rl2_unblit(sprite->image, canvas, sprite->x, sprite->y, sprite->bg);
-        sprite = rl2_sprites[--i - 1];
+        return;
+    }
+
+    if (rl2_drawnBands > 1) {
+        rl2_parallelFor(rl2_unblitBandJob, canvas, rl2_drawnBands);
+        rl2_damageBands(canvas);
+        return;
+    }
+
+    for (size_t i = rl2_visibleSpriteCount; i > 0; i--) {
+        uint32_t const slot = rl2_sprites[i - 1];
+        rl2_Sprite const sprite = rl2_spriteAt(slot);
+
+        if (sprite->bg_size != 0 && !rl2_spriteCulled[slot]) {
+            rl2_unblitFlipped(
+                rl2_spriteImages[slot], canvas, rl2_spriteX[slot], rl2_spriteY[slot], rl2_spriteFlips[slot],
+                sprite->bg);
+        }
     }
-    while (i > 0);
 }
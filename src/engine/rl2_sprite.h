@@ -11,8 +11,30 @@ void rl2_destroySprite(rl2_Sprite const sprite);
 void rl2_setPosition(rl2_Sprite const sprite, int const x, int const y);
 void rl2_setLayer(rl2_Sprite const sprite, unsigned const layer);
 bool rl2_setImage(rl2_Sprite const sprite, rl2_Image const image);
+
+// Draws the image mirrored with rl2_ImageFlip flags, so one image serves both directions a sprite can face
+void rl2_setFlip(rl2_Sprite const sprite, unsigned const flip);
 void rl2_setVisibility(rl2_Sprite const sprite, bool const visible);
 
+// Sprites drawn over a static background can be erased by copying it back instead of saving and restoring the
+// pixels each one overwrites; rl2_blitSprites picks whatever moves less pixels each frame. The background must have
+// the same size as the canvas passed to rl2_blitSprites and rl2_unblitSprites, pass NULL to stop using it.
+// rl2_unblitSprites copies from the background set when the sprites were blitted, which must live until then
+void rl2_setSpriteBackground(rl2_Canvas const background);
+
+// Splits the canvas in count horizontal bands that rl2_blitSprites and rl2_unblitSprites draw in parallel on the
+// workers started with rl2_startWorkers; 0 or 1 draws everything on the calling thread. Incremental redraw doesn't use
+// bands
+void rl2_setSpriteBands(unsigned const count);
+
+// Incremental redraw keeps sprites on the canvas, rl2_blitSprites only erases and draws again the ones that changed
+// since the last frame along with the ones that overlap them, and rl2_unblitSprites does nothing. Nothing else may
+// draw to the canvas while it's on. Turn it on after rl2_unblitSprites, the next rl2_blitSprites erases all sprites
+// left on the canvas after it's turned off
+void rl2_setIncrementalSprites(bool const enable);
+
+// Sprites completely covered by the rl2_opaqueRect of a sprite drawn after them are neither drawn nor erased, except
+// with incremental redraw
 void rl2_blitSprites(rl2_Canvas const canvas);
 void rl2_unblitSprites(rl2_Canvas const canvas);
 
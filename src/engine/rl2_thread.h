@@ -0,0 +1,71 @@
+#ifndef RL2_THREAD_H__
+#define RL2_THREAD_H__
+
+// Thin wrappers over Win32 and pthreads; translation units including this on POSIX systems must define
+// _POSIX_C_SOURCE before their first include. Mutexes can be statically initialized with RL2_MUTEX_INIT, and
+// rl2_callOnce runs a void (*)(void) function exactly once for an rl2_Once initialized with RL2_ONCE_INIT
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#ifdef _WIN32
+typedef HANDLE rl2_Thread;
+typedef SRWLOCK rl2_Mutex;
+typedef CONDITION_VARIABLE rl2_Cond;
+typedef INIT_ONCE rl2_Once;
+
+typedef struct {
+    void (*func)(void);
+}
+rl2_OnceFunc;
+
+static inline BOOL CALLBACK rl2_runOnce(PINIT_ONCE const once, PVOID const param, PVOID* const context) {
+    (void)once;
+    (void)context;
+    ((rl2_OnceFunc const*)param)->func();
+    return TRUE;
+}
+
+#define RL2_THREAD_FUNC(name) DWORD WINAPI name(LPVOID const arg)
+#define RL2_MUTEX_INIT SRWLOCK_INIT
+#define RL2_ONCE_INIT INIT_ONCE_STATIC_INIT
+
+#define rl2_startThread(t, func) ((*(t) = CreateThread(NULL, 0, func, NULL, 0, NULL)) != NULL)
+#define rl2_joinThread(t) do { WaitForSingleObject(t, INFINITE); CloseHandle(t); } while (0)
+#define rl2_mutexInit(m) InitializeSRWLock(m)
+#define rl2_mutexDestroy(m) do {} while (0)
+#define rl2_lock(m) AcquireSRWLockExclusive(m)
+#define rl2_unlock(m) ReleaseSRWLockExclusive(m)
+#define rl2_condInit(c) InitializeConditionVariable(c)
+#define rl2_condDestroy(c) do {} while (0)
+#define rl2_wait(c, m) SleepConditionVariableSRW(c, m, INFINITE, 0)
+#define rl2_broadcast(c) WakeAllConditionVariable(c)
+#define rl2_callOnce(o, f) \
+    do { rl2_OnceFunc const rl2_onceFunc = {f}; InitOnceExecuteOnce(o, rl2_runOnce, (PVOID)&rl2_onceFunc, NULL); } while (0)
+#else
+typedef pthread_t rl2_Thread;
+typedef pthread_mutex_t rl2_Mutex;
+typedef pthread_cond_t rl2_Cond;
+typedef pthread_once_t rl2_Once;
+
+#define RL2_THREAD_FUNC(name) void* name(void* const arg)
+#define RL2_MUTEX_INIT PTHREAD_MUTEX_INITIALIZER
+#define RL2_ONCE_INIT PTHREAD_ONCE_INIT
+
+#define rl2_startThread(t, func) (pthread_create(t, NULL, func, NULL) == 0)
+#define rl2_joinThread(t) pthread_join(t, NULL)
+#define rl2_mutexInit(m) pthread_mutex_init(m, NULL)
+#define rl2_mutexDestroy(m) pthread_mutex_destroy(m)
+#define rl2_lock(m) pthread_mutex_lock(m)
+#define rl2_unlock(m) pthread_mutex_unlock(m)
+#define rl2_condInit(c) pthread_cond_init(c, NULL)
+#define rl2_condDestroy(c) pthread_cond_destroy(c)
+#define rl2_wait(c, m) pthread_cond_wait(c, m)
+#define rl2_broadcast(c) pthread_cond_broadcast(c)
+#define rl2_callOnce(o, f) pthread_once(o, f)
+#endif
+
+#endif // RL2_THREAD_H__
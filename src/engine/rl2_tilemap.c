@@ -0,0 +1,246 @@
+#include "rl2_tilemap.h"
+#include "rl2_heap.h"
+#include "rl2_log.h"
+
+#include <string.h>
+
+#define TAG "MAP "
+
+// Changed cells remembered until the next render, more than that redraws the whole canvas
+#define RL2_MAX_DIRTY_TILES 256
+
+typedef enum {
+    // Drawn with row copies, nothing shows through
+    RL2_TILE_OPAQUE,
+
+    // Needs the background under it
+    RL2_TILE_TRANSPARENT,
+
+    // No visible pixels, only the background is drawn
+    RL2_TILE_EMPTY
+}
+rl2_TileKind;
+
+struct rl2_Tilemap {
+    rl2_Image const* tiles;
+    uint8_t* kinds;
+    size_t count;
+
+    unsigned tile_width;
+    unsigned tile_height;
+    unsigned columns;
+    unsigned rows;
+    rl2_Pixel background;
+
+    // What the canvas shows since the last render, if valid
+    rl2_Canvas canvas;
+    int x;
+    int y;
+    bool valid;
+
+    uint32_t dirty[RL2_MAX_DIRTY_TILES];
+    size_t dirty_count;
+
+    uint16_t cells[1];
+};
+
+rl2_Tilemap rl2_createTilemap(
+    rl2_Image const* const tiles, size_t const count, unsigned const tile_width, unsigned const tile_height,
+    unsigned const columns, unsigned const rows) {
+
+    if (tile_width == 0 || tile_height == 0 || columns == 0 || rows == 0 || count > RL2_NO_TILE) {
+        RL2_ERROR(TAG "invalid tilemap, %zu tiles of %ux%u in %ux%u cells", count, tile_width, tile_height, columns, rows);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (rl2_imageWidth(tiles[i]) != tile_width || rl2_imageHeight(tiles[i]) != tile_height) {
+            RL2_ERROR(
+                TAG "tile %zu is %ux%u instead of %ux%u", i, rl2_imageWidth(tiles[i]), rl2_imageHeight(tiles[i]),
+                tile_width, tile_height);
+
+            return NULL;
+        }
+    }
+
+    size_t const num_cells = (size_t)columns * rows;
+    size_t const size = sizeof(struct rl2_Tilemap) + sizeof(uint16_t) * (num_cells - 1);
+    rl2_Tilemap const map = (rl2_Tilemap)rl2_alloc(size + count);
+
+    if (map == NULL) {
+        RL2_ERROR(TAG "out of memory");
+        return NULL;
+    }
+
+    // Classify the tiles once so that rendering knows which ones need the background
+    map->tiles = tiles;
+    map->kinds = (uint8_t*)map + size;
+    map->count = count;
+
+    for (size_t i = 0; i < count; i++) {
+        map->kinds[i] = rl2_isImageOpaque(tiles[i]) ? RL2_TILE_OPAQUE :
+                        rl2_changedPixels(tiles[i]) == 0 ? RL2_TILE_EMPTY : RL2_TILE_TRANSPARENT;
+    }
+
+    map->tile_width = tile_width;
+    map->tile_height = tile_height;
+    map->columns = columns;
+    map->rows = rows;
+    map->background = RL2_COLOR(0, 0, 0);
+
+    map->canvas = NULL;
+    map->valid = false;
+    map->dirty_count = 0;
+
+    for (size_t i = 0; i < num_cells; i++) {
+        map->cells[i] = RL2_NO_TILE;
+    }
+
+    return map;
+}
+
+void rl2_destroyTilemap(rl2_Tilemap const map) {
+    rl2_free(map);
+}
+
+void rl2_setTile(rl2_Tilemap const map, unsigned const column, unsigned const row, uint16_t const tile) {
+    if (column >= map->columns || row >= map->rows || (tile != RL2_NO_TILE && tile >= map->count)) {
+        RL2_ERROR(TAG "invalid tile %u at %u, %u", tile, column, row);
+        return;
+    }
+
+    uint32_t const cell = row * map->columns + column;
+
+    if (map->cells[cell] == tile) {
+        return;
+    }
+
+    map->cells[cell] = tile;
+
+    if (map->dirty_count < RL2_MAX_DIRTY_TILES) {
+        map->dirty[map->dirty_count++] = cell;
+    }
+    else {
+        map->valid = false;
+    }
+}
+
+uint16_t rl2_getTile(rl2_Tilemap const map, unsigned const column, unsigned const row) {
+    if (column >= map->columns || row >= map->rows) {
+        return RL2_NO_TILE;
+    }
+
+    return map->cells[row * map->columns + column];
+}
+
+void rl2_setTilemapBackground(rl2_Tilemap const map, rl2_Pixel const color) {
+    map->background = color;
+    map->valid = false;
+}
+
+void rl2_invalidateTilemap(rl2_Tilemap const map) {
+    map->valid = false;
+}
+
+static int64_t rl2_floorDiv(int64_t const a, unsigned const b) {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+// Draws the cell at canvas position (x0, y0), only touching the canvas rows in [top, bottom)
+static void rl2_drawCell(
+    rl2_Tilemap const map, rl2_Canvas const canvas, int64_t const column, int64_t const row, int const x0,
+    int const y0, rl2_DamageRect const* const rect) {
+
+    uint16_t const tile = column >= 0 && column < map->columns && row >= 0 && row < map->rows ?
+        map->cells[row * map->columns + column] : RL2_NO_TILE;
+
+    rl2_TileKind const kind = tile != RL2_NO_TILE ? (rl2_TileKind)map->kinds[tile] : RL2_TILE_EMPTY;
+
+    if (kind != RL2_TILE_OPAQUE) {
+        int64_t const right = (int64_t)rect->x0 + rect->width, bottom = (int64_t)rect->y0 + rect->height;
+        int64_t const fill_left = x0 > (int64_t)rect->x0 ? (int64_t)x0 : (int64_t)rect->x0;
+        int64_t const fill_top = y0 > (int64_t)rect->y0 ? (int64_t)y0 : (int64_t)rect->y0;
+        int64_t const fill_right = (int64_t)x0 + map->tile_width < right ? (int64_t)x0 + map->tile_width : right;
+        int64_t const fill_bottom = (int64_t)y0 + map->tile_height < bottom ? (int64_t)y0 + map->tile_height : bottom;
+
+        if (fill_left < fill_right && fill_top < fill_bottom) {
+            rl2_fillRect(
+                canvas, (int)fill_left, (int)fill_top, (unsigned)(fill_right - fill_left),
+                (unsigned)(fill_bottom - fill_top), map->background);
+        }
+    }
+
+    if (kind != RL2_TILE_EMPTY) {
+        rl2_stampArea(map->tiles[tile], canvas, x0, y0, RL2_FLIP_NONE, rect);
+    }
+}
+
+// Draws all cells overlapping the canvas rectangle clipped to it, and damages it since stamping doesn't
+static void rl2_drawCells(rl2_Tilemap const map, rl2_Canvas const canvas, rl2_DamageRect const* const rect) {
+    int64_t const left = (int64_t)map->x + rect->x0, top = (int64_t)map->y + rect->y0;
+    int64_t const first_column = rl2_floorDiv(left, map->tile_width);
+    int64_t const last_column = rl2_floorDiv(left + rect->width - 1, map->tile_width);
+    int64_t const first_row = rl2_floorDiv(top, map->tile_height);
+    int64_t const last_row = rl2_floorDiv(top + rect->height - 1, map->tile_height);
+
+    for (int64_t row = first_row; row <= last_row; row++) {
+        int const y0 = (int)(row * map->tile_height - map->y);
+
+        for (int64_t column = first_column; column <= last_column; column++) {
+            int const x0 = (int)(column * map->tile_width - map->x);
+            rl2_drawCell(map, canvas, column, row, x0, y0, rect);
+        }
+    }
+
+    rl2_damageCanvas(canvas, rect->x0, rect->y0, rect->width, rect->height);
+}
+
+void rl2_renderTilemap(rl2_Tilemap const map, rl2_Canvas const canvas, int const x, int const y) {
+    rl2_DamageRect rects[2];
+    size_t count = 0;
+
+    if (map->valid && map->canvas == canvas) {
+        // Keep what's still visible and draw the rest
+        count = rl2_scrollCanvas(canvas, map->x - x, map->y - y, rects);
+    }
+    else {
+        rects[0].x0 = rects[0].y0 = 0;
+        rects[0].width = rl2_canvasWidth(canvas);
+        rects[0].height = rl2_canvasHeight(canvas);
+        count = 1;
+
+        // Everything is drawn, changed cells included
+        map->dirty_count = 0;
+    }
+
+    map->canvas = canvas;
+    map->x = x;
+    map->y = y;
+    map->valid = true;
+
+    for (size_t i = 0; i < count; i++) {
+        rl2_drawCells(map, canvas, rects + i);
+    }
+
+    // Cells that aren't visible will be drawn when they scroll in
+    for (size_t i = 0; i < map->dirty_count; i++) {
+        unsigned const column = map->dirty[i] % map->columns;
+        unsigned const row = map->dirty[i] / map->columns;
+        int64_t const x0 = (int64_t)column * map->tile_width - x;
+        int64_t const y0 = (int64_t)row * map->tile_height - y;
+        int64_t const x1 = x0 + map->tile_width, y1 = y0 + map->tile_height;
+        int64_t const width = rl2_canvasWidth(canvas), height = rl2_canvasHeight(canvas);
+
+        if (x1 > 0 && x0 < width && y1 > 0 && y0 < height) {
+            rl2_DamageRect rect;
+            rect.x0 = x0 > 0 ? (unsigned)x0 : 0;
+            rect.y0 = y0 > 0 ? (unsigned)y0 : 0;
+            rect.width = (unsigned)((x1 < width ? x1 : width) - rect.x0);
+            rect.height = (unsigned)((y1 < height ? y1 : height) - rect.y0);
+
+            rl2_drawCells(map, canvas, &rect);
+        }
+    }
+
+    map->dirty_count = 0;
+}
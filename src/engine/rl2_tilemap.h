@@ -0,0 +1,36 @@
+#ifndef RL2_TILEMAP_H__
+#define RL2_TILEMAP_H__
+
+#include "rl2_image.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define RL2_NO_TILE UINT16_MAX
+
+typedef struct rl2_Tilemap* rl2_Tilemap;
+
+// A grid of columns * rows cells, each one RL2_NO_TILE or an index into tiles; the tiles must be tile_width by
+// tile_height and outlive the map. All cells start empty
+rl2_Tilemap rl2_createTilemap(
+    rl2_Image const* const tiles, size_t const count, unsigned const tile_width, unsigned const tile_height,
+    unsigned const columns, unsigned const rows);
+
+void rl2_destroyTilemap(rl2_Tilemap const map);
+
+void rl2_setTile(rl2_Tilemap const map, unsigned const column, unsigned const row, uint16_t const tile);
+uint16_t rl2_getTile(rl2_Tilemap const map, unsigned const column, unsigned const row);
+
+// Color drawn under transparent tiles, in empty cells and outside the map
+void rl2_setTilemapBackground(rl2_Tilemap const map, rl2_Pixel const color);
+
+// Draws the map with its pixel (x, y) at the top-left corner of canvas. The map owns the canvas: the first time, and
+// after rl2_invalidateTilemap, everything is drawn, after that the canvas itself is scrolled with rl2_scrollCanvas by
+// the change in (x, y) and only the tiles that came into view or were changed by rl2_setTile are drawn. Enabling
+// rl2_ringCanvasRows on the canvas makes vertical scrolling cheaper, the map never does it. Sprites must be erased
+// before and drawn after rendering the map
+void rl2_renderTilemap(rl2_Tilemap const map, rl2_Canvas const canvas, int const x, int const y);
+void rl2_invalidateTilemap(rl2_Tilemap const map);
+
+#endif // RL2_TILEMAP_H__